@@ -11,6 +11,7 @@
 #include <eosio.system/exchange_state.hpp>
 #include <eosio.system/native.hpp>
 
+#include <array>
 #include <deque>
 #include <optional>
 #include <string>
@@ -111,9 +112,16 @@ namespace eosiosystem {
        int32_t                          block_counter_correction;
        std::vector<producer_metric>     producers_metric;
 
+       // cached copy of the active schedule sorted by name and the header schedule_version it was read at;
+       // while active_schedule_pending is set the cache may be stale and is re-read on the next block
+       binary_extension<uint32_t>           active_schedule_version;
+       binary_extension<std::vector<name>>  active_schedule;
+       binary_extension<bool>               active_schedule_pending;
+
        uint64_t primary_key()const { return last_onblock_caller.value; }
        // explicit serialization macro is not necessary, used here only to improve compilation time
-       EOSLIB_SERIALIZE(schedule_metrics_state, (last_onblock_caller)(block_counter_correction)(producers_metric))
+       EOSLIB_SERIALIZE(schedule_metrics_state, (last_onblock_caller)(block_counter_correction)(producers_metric)
+                                                (active_schedule_version)(active_schedule)(active_schedule_pending))
    };
 
    typedef eosio::singleton< "schedulemetr"_n, schedule_metrics_state > schedule_metrics_singleton;
@@ -148,6 +156,38 @@ namespace eosiosystem {
 
    typedef eosio::singleton< "payrate"_n, payrates > payrate_singleton;
 
+   // weight change of a proxy not yet applied to the producers it votes for, folded into
+   // `producer_info::total_votes` before the producers table is next read by vote order
+   struct [[eosio::table("pendvotes"), eosio::contract("eosio.system")]] pending_vote_delta {
+       name     voter;
+       double   delta = 0;
+
+       uint64_t primary_key()const { return voter.value; }
+       EOSLIB_SERIALIZE(pending_vote_delta, (voter)(delta))
+   };
+
+   typedef eosio::multi_index< "pendvotes"_n, pending_vote_delta > pending_votes_table;
+
+   // phases of `onblock`, used as bits of the SYSTEM_PROFILE phase mask
+   enum class onblock_phase : uint32_t {
+       missed_blocks     = 1,
+       producer_row      = 2,
+       recalculate_votes = 4,
+       schedule_update   = 8,
+       name_bid_close    = 16,
+       rewards_snapshot  = 32
+   };
+
+#ifdef SYSTEM_PROFILE
+   struct [[eosio::table("profmask"), eosio::contract("eosio.system")]] profile_mask {
+       uint32_t disabled_phases = 0;
+
+       EOSLIB_SERIALIZE(profile_mask, (disabled_phases))
+   };
+
+   typedef eosio::singleton< "profmask"_n, profile_mask > profile_mask_singleton;
+#endif
+
    // END TELOS ADDITION
 
 #ifdef EOSIO_SYSTEM_BLOCKCHAIN_PARAMETERS
@@ -235,6 +275,11 @@ namespace eosiosystem {
       block_timestamp      last_block_num; /* deprecated */
       double               total_producer_votepay_share = 0;
       uint8_t              revision = 0; ///< used to track version updates in the future.
+
+      // highest open name bid, mirrors the front of the `highbid` index so onblock can skip the table
+      binary_extension<name>        top_bid_name;
+      binary_extension<int64_t>     top_bid_amount;
+      binary_extension<time_point>  top_bid_time;
       // END TELOS ADDITION
 
       // explicit serialization macro is not necessary, used here only to improve compilation time
@@ -243,7 +288,8 @@ namespace eosiosystem {
                                  (last_producer_schedule_update)(last_proposed_schedule_update)(last_pervote_bucket_fill)
                                  (pervote_bucket)(perblock_bucket)(total_unpaid_blocks)(total_activated_stake)(thresh_activated_stake_time)
                                  (last_producer_schedule_size)(total_producer_vote_weight)(last_name_close)(block_num)(last_claimrewards)(next_payment)
-                                 (new_ram_per_block)(last_ram_increase)(last_block_num)(total_producer_votepay_share)(revision) )
+                                 (new_ram_per_block)(last_ram_increase)(last_block_num)(total_producer_votepay_share)(revision)
+                                 (top_bid_name)(top_bid_amount)(top_bid_time) )
    };
 
    // Defines new global state parameters added after version 1.0
@@ -526,10 +572,37 @@ namespace eosiosystem {
    };
 
 
+   // TELOS ADDITION
+   // One entry of a `delegatebatch` action.
+   struct delegation {
+      name          receiver;
+      asset         stake_net_quantity;
+      asset         stake_cpu_quantity;
+
+      EOSLIB_SERIALIZE( delegation, (receiver)(stake_net_quantity)(stake_cpu_quantity) )
+   };
+
    typedef eosio::multi_index< "userres"_n, user_resources >      user_resources_table;
    typedef eosio::multi_index< "delband"_n, delegated_bandwidth > del_bandwidth_table;
    typedef eosio::multi_index< "refunds"_n, refund_request >      refunds_table;
 
+   // TELOS ADDITION
+   // Refunds waiting to be paid out by `refundexec`, ordered by the time they become claimable.
+   // `changebw` and `refund` keep each entry in step with its refund request.
+   struct [[eosio::table("refundq"), eosio::contract("eosio.system")]] refund_queue_entry {
+      name            owner;
+      time_point_sec  ready_time;
+
+      uint64_t  primary_key()const { return owner.value; }
+      uint64_t  by_ready()const    { return ready_time.utc_seconds; }
+
+      EOSLIB_SERIALIZE( refund_queue_entry, (owner)(ready_time) )
+   };
+
+   typedef eosio::multi_index< "refundq"_n, refund_queue_entry,
+                               indexed_by<"byready"_n, const_mem_fun<refund_queue_entry, uint64_t, &refund_queue_entry::by_ready>>
+                             > refund_queue_table;
+
    // `rex_pool` structure underlying the rex pool table. A rex pool table entry is defined by:
    // - `version` defaulted to zero,
    // - `total_lent` total amount of CORE_SYMBOL in open rex_loans
@@ -549,6 +622,17 @@ namespace eosiosystem {
       asset      namebid_proceeds;
       uint64_t   loan_num = 0;
 
+      // TELOS ADDITION
+      // runrex work watermarks, set by the first full runrex pass on existing rows
+      binary_extension<time_point> next_loan_expiration; ///< earliest cpu/net loan expiration, maximum when there are none
+      binary_extension<bool>       pending_orders;       ///< true while unfilled sellrex orders may be queued
+
+      /// most loans and orders of each kind a runrex triggered by a user REX action processes when a backlog exists
+      static constexpr uint16_t max_runrex_batch = 8;
+
+      /// unlent tokens that can pay out sellrex orders, 20% of lent tokens stay in the pool (TELOS SPECIFIC)
+      int64_t available_unlent()const { return total_unlent.amount - int64_t( ( uint128_t(2) * total_lent.amount ) / 10 ); }
+
       uint64_t primary_key()const { return 0; }
    };
 
@@ -581,14 +665,69 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "rexretpool"_n, rex_return_pool > rex_return_pool_table;
 
+   // `rex_return_bucket` a single 12-hour bucket of the return buckets ring, defined by:
+   // - `time` start of the bucket,
+   // - `rate` proceeds released per distribution interval
+   struct rex_return_bucket {
+      time_point_sec time;
+      int64_t        rate = 0;
+
+      EOSLIB_SERIALIZE( rex_return_bucket, (time)(rate) )
+   };
+
+   // `rex_return_ring` fixed-slot ring of return buckets ordered by time, defined by:
+   // - `head` slot of the oldest bucket,
+   // - `size` number of live buckets,
+   // - `slots` fixed array of slots, serialized without a length prefix so the row never changes size
+   struct rex_return_ring {
+      static constexpr uint8_t max_buckets = 60; // 30 days of 12-hour buckets
+      static_assert( max_buckets * rex_return_pool::hours_per_bucket * seconds_per_hour
+                     == rex_return_pool::total_intervals * rex_return_pool::dist_interval );
+
+      uint8_t                                           head = 0;
+      uint8_t                                           size = 0;
+      // one spare slot, a new bucket is pushed before expired ones are popped
+      std::array<rex_return_bucket, max_buckets + 1>    slots{};
+
+      bool empty()const { return size == 0; }
+      const rex_return_bucket& front()const { return slots[head]; }
+
+      void push_back( const time_point_sec& time, int64_t rate ) {
+         if ( size > 0 ) {
+            auto& last = slots[(head + size - 1) % slots.size()];
+            if ( last.time == time ) {
+               last.rate = rate;
+               return;
+            }
+         }
+         check( size < slots.size(), "rex return buckets ring is full" );
+         slots[(head + size) % slots.size()] = rex_return_bucket{ time, rate };
+         ++size;
+      }
+
+      void pop_front() {
+         slots[head] = rex_return_bucket{};
+         head        = (head + 1) % slots.size();
+         --size;
+      }
+
+      EOSLIB_SERIALIZE( rex_return_ring, (head)(size)(slots) )
+   };
+
    // `rex_return_buckets` structure underlying the rex return buckets table. A rex return buckets table is defined by:
-   // - `version` defaulted to zero,
-   // - `return_buckets` buckets of proceeds accumulated in 12-hour intervals
+   // - `version` zero for the legacy map layout, `ring_version` once migrated,
+   // - `return_buckets` buckets of proceeds accumulated in 12-hour intervals, only used by version zero,
+   // - `ring` the same buckets in a fixed-slot ring, used from `ring_version` on
    struct [[eosio::table,eosio::contract("eosio.system")]] rex_return_buckets {
+      static constexpr uint8_t ring_version = 1;
+
       uint8_t                           version = 0;
       std::map<time_point_sec, int64_t> return_buckets;
+      binary_extension<rex_return_ring> ring;
 
       uint64_t primary_key()const { return 0; }
+
+      EOSLIB_SERIALIZE( rex_return_buckets, (version)(return_buckets)(ring) )
    };
 
    typedef eosio::multi_index< "retbuckets"_n, rex_return_buckets > rex_return_buckets_table;
@@ -607,21 +746,77 @@ namespace eosiosystem {
 
    typedef eosio::multi_index< "rexfund"_n, rex_fund > rex_fund_table;
 
+   // `rex_maturity_bucket` a single daily maturity bucket, defined by:
+   // - `time` time at which the REX in the bucket matures,
+   // - `rex` amount of REX in the bucket
+   struct rex_maturity_bucket {
+      time_point_sec time;
+      int64_t        rex = 0;
+
+      EOSLIB_SERIALIZE( rex_maturity_bucket, (time)(rex) )
+   };
+
+   // `rex_maturity_slots` fixed-slot ring of REX maturity buckets ordered by time, defined by:
+   // - `head` slot of the earliest bucket,
+   // - `size` number of live buckets,
+   // - `slots` fixed array of slots, serialized without a length prefix so the row never changes size,
+   // - `savings` REX in the savings bucket, which never matures
+   struct rex_maturity_slots {
+      // buckets are daily and REX matures within 5 days, plus one spare slot
+      static constexpr uint8_t max_buckets = 6;
+
+      uint8_t                                          head    = 0;
+      uint8_t                                          size    = 0;
+      std::array<rex_maturity_bucket, max_buckets>     slots{};
+      int64_t                                          savings = 0;
+
+      bool empty()const { return size == 0; }
+      const rex_maturity_bucket& operator[]( uint8_t i )const { return slots[(head + i) % max_buckets]; }
+      rex_maturity_bucket& front() { return slots[head]; }
+      rex_maturity_bucket& back() { return slots[(head + size - 1) % max_buckets]; }
+
+      void push_back( const time_point_sec& time, int64_t rex ) {
+         check( size < max_buckets, "too many REX maturity buckets" );
+         slots[(head + size) % max_buckets] = rex_maturity_bucket{ time, rex };
+         ++size;
+      }
+
+      void pop_front() {
+         slots[head] = rex_maturity_bucket{};
+         head        = (head + 1) % max_buckets;
+         --size;
+      }
+
+      void pop_back() {
+         back() = rex_maturity_bucket{};
+         --size;
+      }
+
+      EOSLIB_SERIALIZE( rex_maturity_slots, (head)(size)(slots)(savings) )
+   };
+
    // `rex_balance` structure underlying the rex balance table. A rex balance table entry is defined by:
-   // - `version` defaulted to zero,
+   // - `version` zero for the legacy deque layout, `slots_version` once migrated,
    // - `owner` the owner of the rex fund,
    // - `vote_stake` the amount of CORE_SYMBOL currently included in owner's vote,
    // - `rex_balance` the amount of REX owned by owner,
-   // - `matured_rex` matured REX available for selling
+   // - `matured_rex` matured REX available for selling,
+   // - `rex_maturities` REX daily maturity buckets, savings last, only used by version zero,
+   // - `maturity_slots` the same buckets in fixed slots, used from `slots_version` on
    struct [[eosio::table,eosio::contract("eosio.system")]] rex_balance {
+      static constexpr uint8_t slots_version = 1;
+
       uint8_t version = 0;
       name    owner;
       asset   vote_stake;
       asset   rex_balance;
       int64_t matured_rex = 0;
       std::deque<std::pair<time_point_sec, int64_t>> rex_maturities; /// REX daily maturity buckets
+      binary_extension<rex_maturity_slots>           maturity_slots;
 
       uint64_t primary_key()const { return owner.value; }
+
+      EOSLIB_SERIALIZE( rex_balance, (version)(owner)(vote_stake)(rex_balance)(matured_rex)(rex_maturities)(maturity_slots) )
    };
 
    typedef eosio::multi_index< "rexbal"_n, rex_balance > rex_balance_table;
@@ -684,6 +879,45 @@ namespace eosiosystem {
       asset stake_change;
    };
 
+   // TELOS ADDITION
+   // Result of the `getrexprice` read-only action.
+   // - `total_lendable`, `total_rex`, `total_lent` and `total_unlent` as currently stored in the rex pool,
+   // - `rex_value` core token value of 1.0000 REX at the current pool ratio.
+   struct rex_price {
+      asset total_lendable;
+      asset total_rex;
+      asset total_lent;
+      asset total_unlent;
+      asset rex_value;
+
+      EOSLIB_SERIALIZE( rex_price, (total_lendable)(total_rex)(total_lent)(total_unlent)(rex_value) )
+   };
+
+   // TELOS ADDITION
+   // Result of the `getrexpos` read-only action, the REX position of `owner` as of the current block.
+   // - `value` core token value of the whole `rex_balance`,
+   // - `matured_rex`, `savings_rex` and `unmatured_rex` split `rex_balance` by availability,
+   //    `maturities` lists the unmatured buckets,
+   // - `order_*` the queued sellrex order of `owner`, if any; `order_open` is false once it was filled.
+   struct rex_position {
+      name                                             owner;
+      asset                                            rex_balance;
+      asset                                            value;
+      asset                                            vote_stake;
+      int64_t                                          matured_rex = 0;
+      int64_t                                          savings_rex = 0;
+      int64_t                                          unmatured_rex = 0;
+      std::vector<std::pair<time_point_sec, int64_t>>  maturities;
+      bool                                             has_order = false;
+      bool                                             order_open = false;
+      asset                                            order_rex_requested;
+      asset                                            order_proceeds;
+      time_point                                       order_time;
+
+      EOSLIB_SERIALIZE( rex_position, (owner)(rex_balance)(value)(vote_stake)(matured_rex)(savings_rex)(unmatured_rex)
+                                      (maturities)(has_order)(order_open)(order_rex_requested)(order_proceeds)(order_time) )
+   };
+
    struct powerup_config_resource {
       std::optional<int64_t>        current_weight_ratio;   // Immediately set weight_ratio to this amount. 1x = 10^15. 0.01x = 10^13.
                                                             //    Do not specify to preserve the existing setting or use the default;
@@ -777,6 +1011,8 @@ namespace eosiosystem {
       powerup_state_resource     cpu               = {};                     // CPU market state
       uint32_t                   powerup_days      = default_powerup_days;   // `powerup` `days` argument must match this.
       asset                      min_powerup_fee   = {};                     // fees below this amount are rejected
+      binary_extension<time_point_sec> next_expiration;                      // earliest `powup.order` expiry, maximum if
+                                                                             //    the queue is empty; absent until first processed
 
       uint64_t primary_key()const { return 0; }
    };
@@ -845,6 +1081,10 @@ namespace eosiosystem {
          payrate_singleton           _payrate;
          payrates                    _gpayrate;
          payments_table              _payments;
+#ifdef SYSTEM_PROFILE
+         uint32_t                    _disabled_phases = 0;
+         uint32_t                    _profiled_phases = 0;
+#endif
 
       public:
          static constexpr eosio::name active_permission{"active"_n};
@@ -974,6 +1214,20 @@ namespace eosiosystem {
          void delegatebw( const name& from, const name& receiver,
                           const asset& stake_net_quantity, const asset& stake_cpu_quantity, bool transfer );
 
+         /**
+          * Delegate batch action. Same as one `delegatebw` per entry of `delegations`, but the staked tokens
+          * are moved with a single transfer and the voting power of `from` is updated once.
+          *
+          * @param from - the account holding the tokens to be staked,
+          * @param delegations - receivers and the NET and CPU quantities staked for each of them,
+          *    `from` itself may not be one of the receivers,
+          * @param transfer - if true, ownership of staked tokens is transfered to each receiver.
+          *
+          * @post All producers `from` account has voted for will have their votes updated immediately.
+          */
+         [[eosio::action]]
+         void delegatebatch( const name& from, const std::vector<delegation>& delegations, bool transfer );
+
          /**
           * Setrex action, sets total_rent balance of REX pool to the passed value.
           * @param balance - amount to set the REX pool balance.
@@ -1156,12 +1410,31 @@ namespace eosiosystem {
          [[eosio::action]]
          void updaterex( const name& owner );
 
+         /**
+          * Getrexpos read-only action, reports the REX position of `owner` using the contract's own
+          * maturity and pricing math, without changing any state.
+          *
+          * @param owner - REX owner account.
+          *
+          * @return the position, see `rex_position`.
+          */
+         [[eosio::action, eosio::read_only]]
+         rex_position getrexpos( const name& owner );
+
+         /**
+          * Getrexprice read-only action, reports the REX pool totals and the current value of 1.0000 REX.
+          *
+          * @return the pool totals and price, see `rex_price`.
+          */
+         [[eosio::action, eosio::read_only]]
+         rex_price getrexprice();
+
          /**
           * Rexexec action, processes max CPU loans, max NET loans, and max queued sellrex orders.
           * Action does not execute anything related to a specific user.
           *
           * @param user - any account can execute this action,
-          * @param max - number of each of CPU loans, NET loans, and sell orders to be processed.
+          * @param max - number of loans, CPU and NET together in order of expiration, and of sell orders to be processed.
           */
          [[eosio::action]]
          void rexexec( const name& user, uint16_t max );
@@ -1211,6 +1484,13 @@ namespace eosiosystem {
          [[eosio::action]]
          void closerex( const name& owner );
 
+         /**
+          * Migrate buckets action, converts the REX return buckets from the legacy map layout
+          * to the fixed-slot ring layout. `update_rex_pool` also migrates on first use.
+          */
+         [[eosio::action]]
+         void migrbuckets();
+
          /**
           * Undelegate bandwitdh action, decreases the total tokens delegated by `from` to `receiver` and/or
           * frees the memory associated with the delegation if there is nothing
@@ -1231,12 +1511,12 @@ namespace eosiosystem {
           * @param unstake_net_quantity - tokens to be unstaked from NET bandwidth,
           * @param unstake_cpu_quantity - tokens to be unstaked from CPU bandwidth,
           *
-          * @post Unstaked tokens are transferred to `from` liquid balance via a
-          *    deferred transaction with a delay of 3 days.
+          * @post Unstaked tokens are transferred to `from` liquid balance after a delay of 3 days,
+          *    either by `refundexec` or by `from` calling `refund`.
           * @post If called during the delay period of a previous `undelegatebw`
-          *    action, pending action is canceled and timer is reset.
+          *    action, the timer is reset.
           * @post All producers `from` account has voted for will have their votes updated immediately.
-          * @post Bandwidth and storage for the deferred transaction are billed to `from`.
+          * @post Storage for the refund request is billed to `from`, its `refundq` entry to the system account.
           */
          [[eosio::action]]
          void undelegatebw( const name& from, const name& receiver,
@@ -1284,6 +1564,18 @@ namespace eosiosystem {
          [[eosio::action]]
          void refund( const name& owner );
 
+         /**
+          * Refundexec action, pays out up to `max` refunds whose delegation-period has passed,
+          * in the order they became claimable. Replaces the per-account deferred `refund` transaction.
+          *
+          * @param user - any account can execute this action,
+          * @param max - maximum number of queue entries to process,
+          * @param skip - owners to step over, e.g. ones whose payout fails; their entries stay queued
+          *    and they can still claim with `refund`.
+          */
+         [[eosio::action]]
+         void refundexec( const name& user, uint16_t max, const std::vector<name>& skip );
+
          // functions defined in voting.cpp
 
          /**
@@ -1417,6 +1709,19 @@ namespace eosiosystem {
          void wasmcfg( const name& settings );
 #endif
 
+#ifdef SYSTEM_PROFILE
+         /**
+          * Set profile mask action, only built with the SYSTEM_PROFILE option. Skips the `onblock`
+          * phases whose `onblock_phase` bit is set. This is a coarse on/off toggle: a masked phase also
+          * skips its state changes, so masked and unmasked runs diverge and their timings do not
+          * attribute cost to a phase.
+          *
+          * @param disabled_phases - bitmask of `onblock_phase` values to skip.
+          */
+         [[eosio::action]]
+         void setprofmask( uint32_t disabled_phases );
+#endif
+
          /**
           * Claim rewards action, claims block producing and vote rewards.
           * @param owner - producer account claiming per-block and per-vote rewards.
@@ -1550,6 +1855,7 @@ namespace eosiosystem {
          using setacctcpu_action = eosio::action_wrapper<"setacctcpu"_n, &system_contract::setacctcpu>;
          using activate_action = eosio::action_wrapper<"activate"_n, &system_contract::activate>;
          using delegatebw_action = eosio::action_wrapper<"delegatebw"_n, &system_contract::delegatebw>;
+         using delegatebatch_action = eosio::action_wrapper<"delegatebatch"_n, &system_contract::delegatebatch>;
          using deposit_action = eosio::action_wrapper<"deposit"_n, &system_contract::deposit>;
          using withdraw_action = eosio::action_wrapper<"withdraw"_n, &system_contract::withdraw>;
          using buyrex_action = eosio::action_wrapper<"buyrex"_n, &system_contract::buyrex>;
@@ -1563,17 +1869,21 @@ namespace eosiosystem {
          using defcpuloan_action = eosio::action_wrapper<"defcpuloan"_n, &system_contract::defcpuloan>;
          using defnetloan_action = eosio::action_wrapper<"defnetloan"_n, &system_contract::defnetloan>;
          using updaterex_action = eosio::action_wrapper<"updaterex"_n, &system_contract::updaterex>;
+         using getrexpos_action = eosio::action_wrapper<"getrexpos"_n, &system_contract::getrexpos>;
+         using getrexprice_action = eosio::action_wrapper<"getrexprice"_n, &system_contract::getrexprice>;
          using rexexec_action = eosio::action_wrapper<"rexexec"_n, &system_contract::rexexec>;
          using setrex_action = eosio::action_wrapper<"setrex"_n, &system_contract::setrex>;
          using mvtosavings_action = eosio::action_wrapper<"mvtosavings"_n, &system_contract::mvtosavings>;
          using mvfrsavings_action = eosio::action_wrapper<"mvfrsavings"_n, &system_contract::mvfrsavings>;
          using consolidate_action = eosio::action_wrapper<"consolidate"_n, &system_contract::consolidate>;
          using closerex_action = eosio::action_wrapper<"closerex"_n, &system_contract::closerex>;
+         using migrbuckets_action = eosio::action_wrapper<"migrbuckets"_n, &system_contract::migrbuckets>;
          using undelegatebw_action = eosio::action_wrapper<"undelegatebw"_n, &system_contract::undelegatebw>;
          using buyram_action = eosio::action_wrapper<"buyram"_n, &system_contract::buyram>;
          using buyrambytes_action = eosio::action_wrapper<"buyrambytes"_n, &system_contract::buyrambytes>;
          using sellram_action = eosio::action_wrapper<"sellram"_n, &system_contract::sellram>;
          using refund_action = eosio::action_wrapper<"refund"_n, &system_contract::refund>;
+         using refundexec_action = eosio::action_wrapper<"refundexec"_n, &system_contract::refundexec>;
          using regproducer_action = eosio::action_wrapper<"regproducer"_n, &system_contract::regproducer>;
          using regproducer2_action = eosio::action_wrapper<"regproducer2"_n, &system_contract::regproducer2>;
          using unregprod_action = eosio::action_wrapper<"unregprod"_n, &system_contract::unregprod>;
@@ -1648,15 +1958,20 @@ namespace eosiosystem {
          void update_ram_supply();
 
          // defined in rex.cpp
-         void runrex( uint16_t max );
+         void runrex( uint16_t max, bool scale_to_backlog = false );
          void update_rex_pool();
+         void migrate_rex_return_buckets();
          void update_resource_limits( const name& from, const name& receiver, int64_t delta_net, int64_t delta_cpu );
          void check_voting_requirement( const name& owner,
                                         const char* error_msg = "must vote for at least 21 producers or for a proxy before buying REX" )const;
          rex_order_outcome fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex );
+         rex_order_outcome fill_rex_order( rex_pool& pool, const rex_balance_table::const_iterator& bitr, const asset& rex );
          asset update_rex_account( const name& owner, const asset& proceeds, const asset& unstake_quant, bool force_vote_update = false );
          void channel_to_rex( const name& from, const asset& amount, bool required = false );
          void channel_namebid_to_rex( const int64_t highest_bid );
+
+         // defined in name_bidding.cpp
+         void refresh_top_bid();
          template <typename T>
          int64_t rent_rex( T& table, const name& from, const name& receiver, const asset& loan_payment, const asset& loan_fund );
          template <typename T>
@@ -1673,10 +1988,13 @@ namespace eosiosystem {
          asset add_to_rex_pool( const asset& payment );
          void add_to_rex_return_pool( const asset& fee );
          void process_rex_maturities( const rex_balance_table::const_iterator& bitr );
+         static void process_rex_maturities( rex_balance& rb );
+         static rex_maturity_slots& migrate_rex_maturities( rex_balance& rb );
+         static void add_rex_maturity( rex_balance& rb, const time_point_sec& maturity, int64_t rex );
          void consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                        const asset& rex_in_sell_order );
-         int64_t read_rex_savings( const rex_balance_table::const_iterator& bitr );
-         void put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex );
+         static int64_t read_rex_savings( rex_balance& rb );
+         static void put_rex_savings( rex_balance& rb, int64_t rex );
          void update_rex_stake( const name& voter );
 
          void add_loan_to_rex_pool( const asset& payment, int64_t rented_tokens, bool new_loan );
@@ -1687,13 +2005,19 @@ namespace eosiosystem {
          // defined in delegate_bandwidth.cpp
          void changebw( name from, const name& receiver,
                         const asset& stake_net_quantity, const asset& stake_cpu_quantity, bool transfer );
+         void update_stake_delegated( const name from, const name receiver, const asset& stake_net_delta, const asset& stake_cpu_delta );
+         void update_user_resources( const name from, const name receiver, const asset& stake_net_delta, const asset& stake_cpu_delta );
          void update_voting_power( const name& voter, const asset& total_update );
+         void enqueue_refund( const name& owner, const time_point_sec& ready_time );
+         void dequeue_refund( const name& owner );
 
          // defined in voting.cpp
          void register_producer( const name& producer, const eosio::block_signing_authority& producer_authority, const std::string& url, uint16_t location );
          void update_elected_producers( const block_timestamp& timestamp );
          void update_votes( const name& voter, const name& proxy, const std::vector<name>& producers, bool voting );
          void propagate_weight_change( const voter_info& voter );
+         void fold_pending_votes();
+         void fold_pending_votes( const name& voter );
          double update_producer_votepay_share( const producers_table2::const_iterator& prod_itr,
                                                const time_point& ct,
                                                double shares_rate, bool reset_to_zero = false );
@@ -1743,17 +2067,19 @@ namespace eosiosystem {
 
          // defined in producer_pay.cpp
          void claimrewards_snapshot();
+         bool profile_phase( onblock_phase phase );
 
          double inverse_vote_weight(double staked, double amountVotedProducers);
          void recalculate_votes();
 
          //defined in system_kick.cpp
          bool crossed_missed_blocks_threshold(uint32_t amountBlocksMissed, uint32_t schedule_size);
+         producer_metric* find_producer_metric(name producer);
          void reset_schedule_metrics(name producer);
          void update_producer_missed_blocks(name producer);
-         bool is_new_schedule_activated(name active_schedule[], uint32_t size);
-         bool is_new_schedule_activated(std::vector<name>& schedule);
-         bool check_missed_blocks(block_timestamp timestamp, name producer);
+         void refresh_active_schedule(uint32_t schedule_version);
+         bool is_new_schedule_activated();
+         bool check_missed_blocks(block_timestamp timestamp, name producer, uint32_t schedule_version);
 
          //define in system_rotation.cpp
          void set_bps_rotation(name bpOut, name sbpIn);
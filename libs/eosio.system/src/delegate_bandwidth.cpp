@@ -8,6 +8,9 @@
 #include <eosio.system/eosio.system.hpp>
 #include <eosio.token/eosio.token.hpp>
 
+#include <algorithm>
+#include <iterator>
+
 namespace eosiosystem {
 
    using eosio::asset;
@@ -181,77 +184,8 @@ namespace eosiosystem {
          from = receiver;
       }
 
-      // update stake delegated from "from" to "receiver"
-      {
-         del_bandwidth_table     del_tbl( get_self(), from.value );
-         auto itr = del_tbl.find( receiver.value );
-         if( itr == del_tbl.end() ) {
-            itr = del_tbl.emplace( from, [&]( auto& dbo ){
-                  dbo.from          = from;
-                  dbo.to            = receiver;
-                  dbo.net_weight    = stake_net_delta;
-                  dbo.cpu_weight    = stake_cpu_delta;
-               });
-         }
-         else {
-            del_tbl.modify( itr, same_payer, [&]( auto& dbo ){
-                  dbo.net_weight    += stake_net_delta;
-                  dbo.cpu_weight    += stake_cpu_delta;
-               });
-         }
-         check( 0 <= itr->net_weight.amount, "insufficient staked net bandwidth" );
-         check( 0 <= itr->cpu_weight.amount, "insufficient staked cpu bandwidth" );
-         if ( itr->is_empty() ) {
-            del_tbl.erase( itr );
-         }
-      } // itr can be invalid, should go out of scope
-
-      // update totals of "receiver"
-      {
-         user_resources_table   totals_tbl( get_self(), receiver.value );
-         auto tot_itr = totals_tbl.find( receiver.value );
-         if( tot_itr ==  totals_tbl.end() ) {
-            tot_itr = totals_tbl.emplace( from, [&]( auto& tot ) {
-                  tot.owner = receiver;
-                  tot.net_weight    = stake_net_delta;
-                  tot.cpu_weight    = stake_cpu_delta;
-               });
-         } else {
-            totals_tbl.modify( tot_itr, from == receiver ? from : same_payer, [&]( auto& tot ) {
-                  tot.net_weight    += stake_net_delta;
-                  tot.cpu_weight    += stake_cpu_delta;
-               });
-         }
-         check( 0 <= tot_itr->net_weight.amount, "insufficient staked total net bandwidth" );
-         check( 0 <= tot_itr->cpu_weight.amount, "insufficient staked total cpu bandwidth" );
-
-         {
-            bool ram_managed = false;
-            bool net_managed = false;
-            bool cpu_managed = false;
-
-            auto voter_itr = _voters.find( receiver.value );
-            if( voter_itr != _voters.end() ) {
-               ram_managed = has_field( voter_itr->flags1, voter_info::flags1_fields::ram_managed );
-               net_managed = has_field( voter_itr->flags1, voter_info::flags1_fields::net_managed );
-               cpu_managed = has_field( voter_itr->flags1, voter_info::flags1_fields::cpu_managed );
-            }
-
-            if( !(net_managed && cpu_managed) ) {
-               int64_t ram_bytes, net, cpu;
-               get_resource_limits( receiver, ram_bytes, net, cpu );
-
-               set_resource_limits( receiver,
-                                    ram_managed ? ram_bytes : std::max( tot_itr->ram_bytes + ram_gift_bytes, ram_bytes ),
-                                    net_managed ? net : tot_itr->net_weight.amount,
-                                    cpu_managed ? cpu : tot_itr->cpu_weight.amount );
-            }
-         }
-
-         if ( tot_itr->is_empty() ) {
-            totals_tbl.erase( tot_itr );
-         }
-      } // tot_itr can be invalid, should go out of scope
+      update_stake_delegated( from, receiver, stake_net_delta, stake_cpu_delta );
+      update_user_resources( from, receiver, stake_net_delta, stake_cpu_delta );
 
       // create refund or update from existing refund
       if ( stake_account != source_stake_from ) { //for eosio both transfer and refund make no sense
@@ -261,7 +195,8 @@ namespace eosiosystem {
          //create/update/delete refund
          auto net_balance = stake_net_delta;
          auto cpu_balance = stake_cpu_delta;
-         bool need_deferred_trx = false;
+         bool need_refund_entry = false;
+         time_point_sec request_time;
 
 
          // net and cpu are same sign by assertions in delegatebw and undelegatebw
@@ -296,9 +231,11 @@ namespace eosiosystem {
 
                if ( req->is_empty() ) {
                   refunds_tbl.erase( req );
-                  need_deferred_trx = false;
+                  need_refund_entry = false;
+                  dequeue_refund( from );
                } else {
-                  need_deferred_trx = true;
+                  need_refund_entry = true;
+                  request_time = req->request_time;
                }
             } else if ( net_balance.amount < 0 || cpu_balance.amount < 0 ) { //need to create refund
                refunds_tbl.emplace( from, [&]( refund_request& r ) {
@@ -316,22 +253,16 @@ namespace eosiosystem {
                      r.cpu_amount = asset( 0, core_symbol() );
                   }
                   r.request_time = current_time_point();
+                  request_time   = r.request_time;
                });
-               need_deferred_trx = true;
+               need_refund_entry = true;
             } // else stake increase requested with no existing row in refunds_tbl -> nothing to do with refunds_tbl
          } /// end if is_delegating_to_self || is_undelegating
 
-         if ( need_deferred_trx ) {
-            eosio::transaction out;
-            out.actions.emplace_back( permission_level{from, active_permission},
-                                      get_self(), "refund"_n,
-                                      from
-            );
-            out.delay_sec = refund_delay_sec;
-            eosio::cancel_deferred( from.value ); // TODO: Remove this line when replacing deferred trxs is fixed
-            out.send( from.value, from, true );
-         } else {
-            eosio::cancel_deferred( from.value );
+         // TELOS SPECIFIC
+         // refunds are paid out by refundexec or claimed with refund, no deferred transaction is scheduled
+         if ( need_refund_entry ) {
+            enqueue_refund( from, request_time + refund_delay_sec );
          }
 
          auto transfer_amount = net_balance + cpu_balance;
@@ -345,6 +276,78 @@ namespace eosiosystem {
       update_voting_power( from, stake_net_delta + stake_cpu_delta );
    }
 
+   void system_contract::update_stake_delegated( const name from, const name receiver, const asset& stake_net_delta, const asset& stake_cpu_delta )
+   {
+      del_bandwidth_table     del_tbl( get_self(), from.value );
+      auto itr = del_tbl.find( receiver.value );
+      if( itr == del_tbl.end() ) {
+         itr = del_tbl.emplace( from, [&]( auto& dbo ){
+               dbo.from          = from;
+               dbo.to            = receiver;
+               dbo.net_weight    = stake_net_delta;
+               dbo.cpu_weight    = stake_cpu_delta;
+            });
+      }
+      else {
+         del_tbl.modify( itr, same_payer, [&]( auto& dbo ){
+               dbo.net_weight    += stake_net_delta;
+               dbo.cpu_weight    += stake_cpu_delta;
+            });
+      }
+      check( 0 <= itr->net_weight.amount, "insufficient staked net bandwidth" );
+      check( 0 <= itr->cpu_weight.amount, "insufficient staked cpu bandwidth" );
+      if ( itr->is_empty() ) {
+         del_tbl.erase( itr );
+      }
+   }
+
+   void system_contract::update_user_resources( const name from, const name receiver, const asset& stake_net_delta, const asset& stake_cpu_delta )
+   {
+      user_resources_table   totals_tbl( get_self(), receiver.value );
+      auto tot_itr = totals_tbl.find( receiver.value );
+      if( tot_itr ==  totals_tbl.end() ) {
+         tot_itr = totals_tbl.emplace( from, [&]( auto& tot ) {
+               tot.owner = receiver;
+               tot.net_weight    = stake_net_delta;
+               tot.cpu_weight    = stake_cpu_delta;
+            });
+      } else {
+         totals_tbl.modify( tot_itr, from == receiver ? from : same_payer, [&]( auto& tot ) {
+               tot.net_weight    += stake_net_delta;
+               tot.cpu_weight    += stake_cpu_delta;
+            });
+      }
+      check( 0 <= tot_itr->net_weight.amount, "insufficient staked total net bandwidth" );
+      check( 0 <= tot_itr->cpu_weight.amount, "insufficient staked total cpu bandwidth" );
+
+      {
+         bool ram_managed = false;
+         bool net_managed = false;
+         bool cpu_managed = false;
+
+         auto voter_itr = _voters.find( receiver.value );
+         if( voter_itr != _voters.end() ) {
+            ram_managed = has_field( voter_itr->flags1, voter_info::flags1_fields::ram_managed );
+            net_managed = has_field( voter_itr->flags1, voter_info::flags1_fields::net_managed );
+            cpu_managed = has_field( voter_itr->flags1, voter_info::flags1_fields::cpu_managed );
+         }
+
+         if( !(net_managed && cpu_managed) ) {
+            int64_t ram_bytes, net, cpu;
+            get_resource_limits( receiver, ram_bytes, net, cpu );
+
+            set_resource_limits( receiver,
+                                 ram_managed ? ram_bytes : std::max( tot_itr->ram_bytes + ram_gift_bytes, ram_bytes ),
+                                 net_managed ? net : tot_itr->net_weight.amount,
+                                 cpu_managed ? cpu : tot_itr->cpu_weight.amount );
+         }
+      }
+
+      if ( tot_itr->is_empty() ) {
+         totals_tbl.erase( tot_itr );
+      }
+   }
+
    void system_contract::update_voting_power( const name& voter, const asset& total_update )
    {
       auto voter_itr = _voters.find( voter.value );
@@ -390,6 +393,42 @@ namespace eosiosystem {
       }
    } // delegatebw
 
+   // TELOS ADDITION
+   void system_contract::delegatebatch( const name& from, const std::vector<delegation>& delegations, bool transfer )
+   {
+      require_auth( from );
+      check( !delegations.empty(), "no delegations" );
+      check( stake_account != from, "cannot delegate from stake account" );
+
+      const asset zero_asset( 0, core_symbol() );
+      asset total_stake = zero_asset;
+      for ( const auto& d : delegations ) {
+         check( d.stake_cpu_quantity >= zero_asset, "must stake a positive amount" );
+         check( d.stake_net_quantity >= zero_asset, "must stake a positive amount" );
+         check( d.stake_net_quantity.amount + d.stake_cpu_quantity.amount > 0, "must stake a positive amount" );
+         check( d.receiver != from, "cannot delegate to self in a batch" );
+
+         // with transfer the receiver owns the stake, exactly as in delegatebw
+         const name owner = transfer ? d.receiver : from;
+         update_stake_delegated( owner, d.receiver, d.stake_net_quantity, d.stake_cpu_quantity );
+         update_user_resources( owner, d.receiver, d.stake_net_quantity, d.stake_cpu_quantity );
+         total_stake += d.stake_net_quantity + d.stake_cpu_quantity;
+
+         if ( transfer ) {
+            vote_stake_updater( owner );
+            update_voting_power( owner, d.stake_net_quantity + d.stake_cpu_quantity );
+         }
+      }
+
+      token::transfer_action transfer_act{ token_account, { {from, active_permission} } };
+      transfer_act.send( from, stake_account, total_stake, "stake bandwidth" );
+
+      if ( !transfer ) {
+         vote_stake_updater( from );
+         update_voting_power( from, total_stake );
+      }
+   } // delegatebatch
+
    void system_contract::undelegatebw( const name& from, const name& receiver,
                                        const asset& unstake_net_quantity, const asset& unstake_cpu_quantity )
    {
@@ -423,7 +462,68 @@ namespace eosiosystem {
       token::transfer_action transfer_act{ token_account, { {stake_account, active_permission}, {req->owner, active_permission} } };
       transfer_act.send( stake_account, req->owner, req->net_amount + req->cpu_amount, "unstake" );
       refunds_tbl.erase( req );
+
+      // TELOS ADDITION
+      dequeue_refund( owner );
    }
 
+   // TELOS ADDITION
+   void system_contract::enqueue_refund( const name& owner, const time_point_sec& ready_time )
+   {
+      // a restarted refund moves its entry to the new ready time;
+      // the entry is billed to the system account, the refund request row stays billed to `owner`
+      refund_queue_table refund_queue( get_self(), get_self().value );
+      auto entry = refund_queue.find( owner.value );
+      if ( entry == refund_queue.end() ) {
+         refund_queue.emplace( get_self(), [&]( auto& e ) {
+            e.owner      = owner;
+            e.ready_time = ready_time;
+         });
+      } else if ( entry->ready_time != ready_time ) {
+         refund_queue.modify( entry, same_payer, [&]( auto& e ) {
+            e.ready_time = ready_time;
+         });
+      }
+   }
+
+   // TELOS ADDITION
+   void system_contract::dequeue_refund( const name& owner )
+   {
+      refund_queue_table refund_queue( get_self(), get_self().value );
+      auto entry = refund_queue.find( owner.value );
+      if ( entry != refund_queue.end() ) {
+         refund_queue.erase( entry );
+      }
+   }
+
+   // TELOS ADDITION
+   void system_contract::refundexec( const name& user, uint16_t max, const std::vector<name>& skip )
+   {
+      require_auth( user );
+      check( max > 0, "max must be positive" );
+
+      const time_point_sec now = current_time_point();
+      refund_queue_table refund_queue( get_self(), get_self().value );
+      auto idx = refund_queue.get_index<"byready"_n>();
+      auto itr = idx.begin();
+      while ( itr != idx.end() && itr->ready_time <= now && max-- > 0 ) {
+         // a payout that fails (e.g. an owner contract rejecting the transfer notification) reverts the whole
+         // action, so callers can step over such owners; their entry stays and they claim with `refund`
+         if ( std::find( skip.begin(), skip.end(), itr->owner ) != skip.end() ) {
+            ++itr;
+            continue;
+         }
+
+         // changebw and refund keep every entry in step with its refund request
+         refunds_table refunds_tbl( get_self(), itr->owner.value );
+         const auto& req = refunds_tbl.get( itr->owner.value, "refund request not found" );
+         check( req.request_time + seconds(refund_delay_sec) <= now, "refund is not available yet" );
+
+         token::transfer_action transfer_act{ token_account, { {stake_account, active_permission} } };
+         transfer_act.send( stake_account, req.owner, req.net_amount + req.cpu_amount, "unstake" );
+         refunds_tbl.erase( req );
+         itr = idx.erase( itr );
+      }
+   }
 
 } //namespace eosiosystem
@@ -3,11 +3,19 @@
 #include <eosio/check.hpp>
 
 #include <cmath>
+#include <limits>
 
 namespace eosiosystem {
 
    using eosio::check;
 
+   namespace {
+      /// floor( a * b / c ), exact as long as the result fits, for a < 2^127 and b, c < 2^64
+      uint128_t mul_div( uint128_t a, uint64_t b, uint64_t c ) {
+         return ( a / c ) * b + ( ( a % c ) * b ) / c;
+      }
+   }
+
    asset exchange_state::convert_to_exchange( connector& reserve, const asset& payment )
    {
       const double S0 = supply.amount;
@@ -82,6 +90,10 @@ namespace eosiosystem {
                                               int64_t out_reserve,
                                               int64_t inp )
    {
+      if ( inp_reserve >= 0 && out_reserve >= 0 && inp > 0 ) {
+         return int64_t( mul_div( uint64_t(inp), uint64_t(out_reserve), uint64_t(inp_reserve) + uint64_t(inp) ) );
+      }
+
       const double ib = inp_reserve;
       const double ob = out_reserve;
       const double in = inp;
@@ -97,6 +109,13 @@ namespace eosiosystem {
                                              int64_t inp_reserve,
                                              int64_t out )
    {
+      if ( inp_reserve >= 0 && out >= 0 && out < out_reserve ) {
+         const uint128_t inp = mul_div( uint64_t(inp_reserve), uint64_t(out), uint64_t(out_reserve - out) );
+         if ( inp <= uint128_t(std::numeric_limits<int64_t>::max()) ) {
+            return int64_t(inp);
+         }
+      }
+
       const double ob = out_reserve;
       const double ib = inp_reserve;
 
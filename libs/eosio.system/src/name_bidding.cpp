@@ -65,6 +65,34 @@ namespace eosiosystem {
             b.last_bid_time = current_time_point();
          });
       }
+
+      // TELOS ADDITION
+      // keep the cached top bid in the same order as the highbid index (amount desc, then name)
+      if( !_gstate.top_bid_name.has_value() ) {
+         refresh_top_bid();
+      } else if( newname == _gstate.top_bid_name.value() ||
+                 bid.amount > _gstate.top_bid_amount.value() ||
+                 (bid.amount == _gstate.top_bid_amount.value() && newname.value < _gstate.top_bid_name.value().value) ) {
+         _gstate.top_bid_name.emplace( newname );
+         _gstate.top_bid_amount.emplace( bid.amount );
+         _gstate.top_bid_time.emplace( current_time_point() );
+      }
+   }
+
+   // TELOS ADDITION
+   void system_contract::refresh_top_bid() {
+      name_bid_table bids(get_self(), get_self().value);
+      auto idx = bids.get_index<"highbid"_n>();
+      auto highest = idx.lower_bound( std::numeric_limits<uint64_t>::max()/2 );
+      if( highest != idx.end() && highest->high_bid > 0 ) {
+         _gstate.top_bid_name.emplace( highest->newname );
+         _gstate.top_bid_amount.emplace( highest->high_bid );
+         _gstate.top_bid_time.emplace( highest->last_bid_time );
+      } else {
+         _gstate.top_bid_name.emplace( name() );
+         _gstate.top_bid_amount.emplace( 0 );
+         _gstate.top_bid_time.emplace( time_point() );
+      }
    }
 
    void system_contract::bidrefund( const name& bidder, const name& newname ) {
@@ -72,15 +72,17 @@ void system_contract::process_powerup_queue(time_point_sec now, symbol core_symb
                                            int64_t& cpu_delta_available) {
    update_utilization(now, state.net);
    update_utilization(now, state.cpu);
-   auto idx = orders.get_index<"byexpires"_n>();
-   while (max_items--) {
-      auto it = idx.begin();
-      if (it == idx.end() || it->expires > now)
-         break;
-      net_delta_available += it->net_weight;
-      cpu_delta_available += it->cpu_weight;
-      adjust_resources(get_self(), it->owner, core_symbol, -it->net_weight, -it->cpu_weight);
-      idx.erase(it);
+   // nothing due: leave the order table alone
+   if (!state.next_expiration.has_value() || state.next_expiration.value() <= now) {
+      auto idx = orders.get_index<"byexpires"_n>();
+      auto it  = idx.begin();
+      while (it != idx.end() && it->expires <= now && max_items--) {
+         net_delta_available += it->net_weight;
+         cpu_delta_available += it->cpu_weight;
+         adjust_resources(get_self(), it->owner, core_symbol, -it->net_weight, -it->cpu_weight);
+         it = idx.erase(it);
+      }
+      state.next_expiration.emplace(it == idx.end() ? time_point_sec::maximum() : it->expires);
    }
    state.net.utilization -= net_delta_available;
    state.cpu.utilization -= cpu_delta_available;
@@ -384,13 +386,15 @@ void system_contract::powerup(const name& payer, const name& receiver, uint32_t
    }
    eosio::check(fee >= state.min_powerup_fee, "calculated fee is below minimum; try powering up with more resources");
 
+   const time_point_sec expires = now + eosio::days(days);
    orders.emplace(payer, [&](auto& order) {
       order.id         = orders.available_primary_key();
       order.owner      = receiver;
       order.net_weight = net_amount;
       order.cpu_weight = cpu_amount;
-      order.expires    = now + eosio::days(days);
+      order.expires    = expires;
    });
+   state.next_expiration.emplace(std::min(state.next_expiration.value(), expires));
    net_delta_available -= net_amount;
    cpu_delta_available -= cpu_amount;
 
@@ -11,6 +11,24 @@ namespace eosiosystem {
    using eosio::microseconds;
    using eosio::token;
 
+#ifdef SYSTEM_PROFILE
+   void system_contract::setprofmask( uint32_t disabled_phases ) {
+      require_auth(get_self());
+
+      profile_mask_singleton mask(get_self(), get_self().value);
+      mask.set(profile_mask{ disabled_phases }, get_self());
+   }
+
+   bool system_contract::profile_phase( onblock_phase phase ) {
+      const auto bit = static_cast<uint32_t>(phase);
+      if( _disabled_phases & bit ) return false;
+      _profiled_phases |= bit;
+      return true;
+   }
+#else
+   inline bool system_contract::profile_phase( onblock_phase ) { return true; }
+#endif
+
    void system_contract::onblock( ignore<block_header> ) {
       using namespace eosio;
 
@@ -18,7 +36,10 @@ namespace eosiosystem {
 
       block_timestamp timestamp;
       name producer;
-      _ds >> timestamp >> producer;
+      uint16_t confirmed;
+      checksum256 previous, transaction_mroot, action_mroot;
+      uint32_t schedule_version;
+      _ds >> timestamp >> producer >> confirmed >> previous >> transaction_mroot >> action_mroot >> schedule_version;
 
       // BEGIN TELOS SPECIFIC: On block handler
       _gstate.block_num++;
@@ -32,7 +53,11 @@ namespace eosiosystem {
      
       if (_gstate.last_pervote_bucket_fill == time_point()) _gstate.last_pervote_bucket_fill = current_time_point();
 
-      if(check_missed_blocks(timestamp, producer)) {
+#ifdef SYSTEM_PROFILE
+      _disabled_phases = profile_mask_singleton(get_self(), get_self().value).get_or_default().disabled_phases;
+#endif
+
+      if(profile_phase(onblock_phase::missed_blocks) && check_missed_blocks(timestamp, producer, schedule_version)) {
           update_missed_blocks_per_rotation();
           reset_schedule_metrics(producer);
       }
@@ -41,7 +66,7 @@ namespace eosiosystem {
        * At startup the initial producer may not be one that is registered / elected
        * and therefore there may be no producer object for them.
        */
-      auto prod = _producers.find( producer.value );
+      auto prod = profile_phase(onblock_phase::producer_row) ? _producers.find( producer.value ) : _producers.end();
       if ( prod != _producers.end() ) {
           _gstate.total_unpaid_blocks++;
           _producers.modify( prod, same_payer, [&](auto& p ) {
@@ -50,36 +75,48 @@ namespace eosiosystem {
           });
       }
 
-      recalculate_votes();
+      if( profile_phase(onblock_phase::recalculate_votes) )
+          recalculate_votes();
 
       /// only update block producers once every minute, block_timestamp is in half seconds
       if( timestamp.slot - _gstate.last_producer_schedule_update.slot > 120 ) {
-          update_elected_producers( timestamp );
-
-          if( (timestamp.slot - _gstate.last_name_close.slot) > blocks_per_day ) {
-              name_bid_table bids(_self, _self.value);
-              auto idx = bids.get_index<"highbid"_n>();
-              auto highest = idx.lower_bound( std::numeric_limits<uint64_t>::max()/2 );
-              if( highest != idx.end() &&
-                  highest->high_bid > 0 &&
-                  (current_time_point() - highest->last_bid_time) > microseconds(useconds_per_day) &&
+          if( profile_phase(onblock_phase::schedule_update) )
+              update_elected_producers( timestamp );
+          else
+              _gstate.last_producer_schedule_update = timestamp; // keep the once-a-minute cadence while masked
+
+          if( (timestamp.slot - _gstate.last_name_close.slot) > blocks_per_day && profile_phase(onblock_phase::name_bid_close) ) {
+              // the top bid is cached in global state, only touch the table when an auction closes
+              if( !_gstate.top_bid_name.has_value() ) {
+                  refresh_top_bid();
+              }
+              if( _gstate.top_bid_amount.value() > 0 &&
+                  (current_time_point() - _gstate.top_bid_time.value()) > microseconds(useconds_per_day) &&
                   _gstate.thresh_activated_stake_time > time_point() &&
                   (current_time_point() - _gstate.thresh_activated_stake_time) > microseconds(14 * useconds_per_day)
               ) {
+                name_bid_table bids(_self, _self.value);
+                const auto& highest = bids.get( _gstate.top_bid_name.value().value, "top bid not found" ); // data corruption
                 _gstate.last_name_close = timestamp;
-                channel_namebid_to_rex( highest->high_bid );
-                idx.modify( highest, same_payer, [&]( auto& b ){
+                channel_namebid_to_rex( highest.high_bid );
+                bids.modify( highest, same_payer, [&]( auto& b ){
                     b.high_bid = -b.high_bid;
                 });
+                refresh_top_bid();
               }
           }
       }
 
       //called once per day to set payments snapshot
-      if (_gstate.last_claimrewards + uint32_t(3600) <= timestamp.slot) { //172800 blocks in a day
+      if (_gstate.last_claimrewards + uint32_t(3600) <= timestamp.slot && profile_phase(onblock_phase::rewards_snapshot)) { //172800 blocks in a day
           claimrewards_snapshot();
           _gstate.last_claimrewards = timestamp.slot;
       }
+
+#ifdef SYSTEM_PROFILE
+      // phases that ran in this block, read back from the action console by the tester
+      eosio::print("PROF{", _profiled_phases, "}");
+#endif
       // END TELOS SPECIFIC
 
       // BEGIN TELOS DELETIONS
@@ -336,6 +373,9 @@ namespace eosiosystem {
             _gstate.last_pervote_bucket_fill = ct;
         }
 
+        // apply deferred proxy weight before reading producers by vote order
+        fold_pending_votes();
+
         //sort producers table
         auto sortedprods = _producers.get_index<"prototalvote"_n>();
         
@@ -2,6 +2,8 @@
 #include <eosio.token/eosio.token.hpp>
 #include <eosio.system/rex.results.hpp>
 
+#include <map>
+
 namespace eosiosystem {
 
    using eosio::current_time_point;
@@ -48,7 +50,7 @@ namespace eosiosystem {
       transfer_from_fund( from, amount );
       const asset rex_received    = add_to_rex_pool( amount );
       const asset delta_rex_stake = add_to_rex_balance( from, amount, rex_received );
-      runrex(2);
+      runrex( 2, true );
       update_rex_account( from, asset( 0, core_symbol() ), delta_rex_stake );
       // dummy action added so that amount of REX tokens purchased shows up in action trace
       rex_results::buyresult_action buyrex_act( rex_account, std::vector<eosio::permission_level>{ } );
@@ -89,7 +91,7 @@ namespace eosiosystem {
       }
       const asset rex_received = add_to_rex_pool( payment );
       auto rex_stake_delta = add_to_rex_balance( owner, payment, rex_received );
-      runrex(2);
+      runrex( 2, true );
       // TELOS SPECIFIC: Null delta stake
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ), true );
       // dummy action added so that amount of REX tokens purchased shows up in action trace
@@ -101,7 +103,7 @@ namespace eosiosystem {
    {
       require_auth( from );
 
-      runrex(2);
+      runrex( 2, true );
 
       auto bitr = _rexbalance.require_find( from.value, "user must first buyrex" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol,
@@ -137,6 +139,11 @@ namespace eosiosystem {
                order.rex_requested.amount += rex.amount;
             });
          }
+         if ( !_rexpool.begin()->pending_orders.has_value() || !_rexpool.begin()->pending_orders.value() ) {
+            _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& rt ) {
+               rt.pending_orders.emplace( true );
+            });
+         }
          pending_sell_order.amount = oitr->rex_requested.amount;
       }
       check( pending_sell_order.amount <= bitr->matured_rex, "insufficient funds for current and scheduled orders" );
@@ -210,7 +217,7 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
-      runrex(2);
+      runrex( 2, true );
 
       auto itr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       const asset init_stake = itr->vote_stake;
@@ -232,6 +239,62 @@ namespace eosiosystem {
       process_rex_maturities( itr );
    }
 
+   // TELOS ADDITION
+   rex_position system_contract::getrexpos( const name& owner )
+   {
+      check( rex_system_initialized(), "rex system not initialized yet" );
+      auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
+      const auto& pool = *_rexpool.begin();
+
+      // mature and split a copy, the stored row is left as is
+      rex_balance rb = *bitr;
+      process_rex_maturities( rb );
+
+      rex_position pos;
+      pos.owner         = owner;
+      pos.rex_balance   = rb.rex_balance;
+      pos.value         = asset( 0, core_symbol() );
+      if ( pool.total_rex.amount > 0 ) {
+         pos.value.amount = ( uint128_t(rb.rex_balance.amount) * pool.total_lendable.amount ) / pool.total_rex.amount;
+      }
+      pos.vote_stake    = rb.vote_stake;
+      pos.matured_rex   = rb.matured_rex;
+      pos.savings_rex   = read_rex_savings( rb );
+      const auto& slots = rb.maturity_slots.value();
+      for ( uint8_t i = 0; i < slots.size; ++i ) {
+         pos.unmatured_rex += slots[i].rex;
+         pos.maturities.emplace_back( slots[i].time, slots[i].rex );
+      }
+
+      auto oitr = _rexorders.find( owner.value );
+      if ( oitr != _rexorders.end() ) {
+         pos.has_order           = true;
+         pos.order_open          = oitr->is_open;
+         pos.order_rex_requested = oitr->rex_requested;
+         pos.order_proceeds      = oitr->proceeds;
+         pos.order_time          = oitr->order_time;
+      }
+      return pos;
+   }
+
+   // TELOS ADDITION
+   rex_price system_contract::getrexprice()
+   {
+      check( rex_system_initialized(), "rex system not initialized yet" );
+      const auto& pool = *_rexpool.begin();
+
+      rex_price price;
+      price.total_lendable = pool.total_lendable;
+      price.total_rex      = pool.total_rex;
+      price.total_lent     = pool.total_lent;
+      price.total_unlent   = pool.total_unlent;
+      price.rex_value      = asset( 0, core_symbol() );
+      if ( pool.total_rex.amount > 0 ) {
+         price.rex_value.amount = ( uint128_t(10'000) * pool.total_lendable.amount ) / pool.total_rex.amount;
+      }
+      return price;
+   }
+
    void system_contract::setrex( const asset& balance )
    {
       require_auth( "eosio"_n );
@@ -255,7 +318,7 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
-      runrex(2);
+      runrex( 2, true );
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       asset rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
@@ -266,23 +329,24 @@ namespace eosiosystem {
    {
       require_auth( owner );
 
-      runrex(2);
+      runrex( 2, true );
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
-      const asset   rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
-      const int64_t rex_in_savings    = read_rex_savings( bitr );
-      check( rex.amount + rex_in_sell_order.amount + rex_in_savings <= bitr->rex_balance.amount,
-             "insufficient REX balance" );
-      process_rex_maturities( bitr );
+      const asset rex_in_sell_order = update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+         const int64_t rex_in_savings = read_rex_savings( rb );
+         check( rex.amount + rex_in_sell_order.amount + rex_in_savings <= rb.rex_balance.amount,
+                "insufficient REX balance" );
+         process_rex_maturities( rb );
+         auto& slots = migrate_rex_maturities( rb );
          int64_t moved_rex = 0;
-         while ( !rb.rex_maturities.empty() && moved_rex < rex.amount) {
-            const int64_t drex = std::min( rex.amount - moved_rex, rb.rex_maturities.back().second );
-            rb.rex_maturities.back().second -= drex;
-            moved_rex                       += drex;
-            if ( rb.rex_maturities.back().second == 0 ) {
-               rb.rex_maturities.pop_back();
+         while ( !slots.empty() && moved_rex < rex.amount) {
+            const int64_t drex = std::min( rex.amount - moved_rex, slots.back().rex );
+            slots.back().rex -= drex;
+            moved_rex        += drex;
+            if ( slots.back().rex == 0 ) {
+               slots.pop_back();
             }
          }
          if ( moved_rex < rex.amount ) {
@@ -292,30 +356,25 @@ namespace eosiosystem {
             check( rex_in_sell_order.amount <= rb.matured_rex, "logic error in mvtosavings" );
          }
          check( moved_rex == rex.amount, "programmer error in mvtosavings" );
+         put_rex_savings( rb, rex_in_savings + rex.amount );
       });
-      put_rex_savings( bitr, rex_in_savings + rex.amount );
    }
 
    void system_contract::mvfrsavings( const name& owner, const asset& rex )
    {
       require_auth( owner );
 
-      runrex(2);
+      runrex( 2, true );
 
       auto bitr = _rexbalance.require_find( owner.value, "account has no REX balance" );
       check( rex.amount > 0 && rex.symbol == bitr->rex_balance.symbol, "asset must be a positive amount of (REX, 4)" );
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      check( rex.amount <= rex_in_savings, "insufficient REX in savings" );
-      process_rex_maturities( bitr );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex.amount;
-         } else {
-            rb.rex_maturities.emplace_back( maturity, rex.amount );
-         }
+         const int64_t rex_in_savings = read_rex_savings( rb );
+         check( rex.amount <= rex_in_savings, "insufficient REX in savings" );
+         process_rex_maturities( rb );
+         add_rex_maturity( rb, get_rex_maturity(), rex.amount );
+         put_rex_savings( rb, rex_in_savings - rex.amount );
       });
-      put_rex_savings( bitr, rex_in_savings - rex.amount );
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
    }
 
@@ -324,7 +383,7 @@ namespace eosiosystem {
       require_auth( owner );
 
       if ( rex_system_initialized() )
-         runrex(2);
+         runrex( 2, true );
 
       update_rex_account( owner, asset( 0, core_symbol() ), asset( 0, core_symbol() ) );
 
@@ -356,6 +415,16 @@ namespace eosiosystem {
       }
    }
 
+   void system_contract::migrbuckets()
+   {
+      require_auth( get_self() );
+
+      const auto ret_buckets_elem = _rexretbuckets.begin();
+      check( ret_buckets_elem != _rexretbuckets.end() && ret_buckets_elem->version < rex_return_buckets::ring_version,
+             "nothing to migrate" );
+      migrate_rex_return_buckets();
+   }
+
    /**
     * @brief Updates account NET and CPU resource limits
     *
@@ -474,6 +543,12 @@ namespace eosiosystem {
          // increment loan_num if a new loan is being created
          if ( new_loan ) {
             rt.loan_num++;
+
+            // TELOS ADDITION
+            const time_point expiration = current_time_point() + eosio::days(30);
+            if ( rt.next_loan_expiration.has_value() && expiration < rt.next_loan_expiration.value() ) {
+               rt.next_loan_expiration.emplace( expiration );
+            }
          }
       });
    }
@@ -518,8 +593,9 @@ namespace eosiosystem {
     * @brief Performs maintenance operations on expired NET and CPU loans and sellrex orders
     *
     * @param max - maximum number of each of the three categories to be processed
+    * @param scale_to_backlog - let a backlog of due items raise `max`, up to rex_pool::max_runrex_batch
     */
-   void system_contract::runrex( uint16_t max )
+   void system_contract::runrex( uint16_t max, bool scale_to_backlog )
    {
       check( rex_system_initialized(), "rex system not initialized yet" );
 
@@ -527,6 +603,24 @@ namespace eosiosystem {
 
       const auto& pool = _rexpool.begin();
 
+      // TELOS ADDITION
+      // nothing is due, skip opening the loan and order tables
+      const time_point now = current_time_point();
+      if ( pool->namebid_proceeds.amount == 0 &&
+           pool->next_loan_expiration.has_value() && now < pool->next_loan_expiration.value() &&
+           pool->pending_orders.has_value() && !pool->pending_orders.value() ) {
+         return;
+      }
+
+      // once `max` items are processed, a scaled pass takes on half of the due items still queued
+      // (at least one), within max_runrex_batch; an explicit `max` is always honored as is
+      const uint16_t max_extra = scale_to_backlog && max < rex_pool::max_runrex_batch ? rex_pool::max_runrex_batch - max : 0;
+      auto extra_budget = [&]( uint16_t depth ) -> uint16_t {
+         return std::min<uint16_t>( ( depth + 1 ) / 2, max_extra );
+      };
+      time_point     next_expiration = time_point( eosio::microseconds::maximum() );
+      bool           pending_orders  = false;
+
       auto process_expired_loan = [&]( auto& idx, const auto& itr ) -> std::pair<bool, int64_t> {
          /// update rex_pool in order to delete existing loan
          remove_loan_from_rex_pool( *itr );
@@ -565,52 +659,91 @@ namespace eosiosystem {
          });
       }
 
-      /// process cpu loans
+      /// process cpu and net loans in order of expiration, `max` loans overall plus any backlog extra
       {
          rex_cpu_loan_table cpu_loans( get_self(), get_self().value );
+         rex_net_loan_table net_loans( get_self(), get_self().value );
          auto cpu_idx = cpu_loans.get_index<"byexpr"_n>();
-         for ( uint16_t i = 0; i < max; ++i ) {
-            auto itr = cpu_idx.begin();
-            if ( itr == cpu_idx.end() || itr->expiration > current_time_point() ) break;
-
-            auto result = process_expired_loan( cpu_idx, itr );
-            if ( result.second != 0 )
-               update_resource_limits( itr->from, itr->receiver, 0, result.second );
+         auto net_idx = net_loans.get_index<"byexpr"_n>();
 
-            if ( result.first )
-               cpu_idx.erase( itr );
+         // resource limit changes are applied once per (from, receiver) pair after the pass,
+         // `from` pays for a user_resources row that update_resource_limits has to create
+         std::map<std::pair<name, name>, std::pair<int64_t, int64_t>> deltas; // net, cpu
+         auto add_delta = [&]( const name& from, const name& receiver, int64_t net, int64_t cpu ) {
+            auto& d = deltas[{ from, receiver }];
+            d.first  += net;
+            d.second += cpu;
+         };
+
+         // due loans at the front of an expiration index, counting stops at `cap`
+         auto count_due = [&]( auto& idx, uint16_t cap ) -> uint16_t {
+            uint16_t n = 0;
+            for ( auto it = idx.begin(); n < cap && it != idx.end() && it->expiration <= now; ++it ) ++n;
+            return n;
+         };
+
+         uint16_t limit = max;
+         for ( uint16_t i = 0; i < limit; ++i ) {
+            if ( i == max && max_extra > 0 ) {
+               const uint16_t cap = 2 * max_extra;
+               limit += extra_budget( std::min<uint16_t>( count_due( cpu_idx, cap ) + count_due( net_idx, cap ), cap ) );
+               if ( i == limit ) break;
+            }
+            auto citr = cpu_idx.begin();
+            auto nitr = net_idx.begin();
+            const bool cpu_due = citr != cpu_idx.end() && citr->expiration <= now;
+            const bool net_due = nitr != net_idx.end() && nitr->expiration <= now;
+            if ( !cpu_due && !net_due ) break;
+
+            if ( cpu_due && ( !net_due || citr->expiration <= nitr->expiration ) ) {
+               auto result = process_expired_loan( cpu_idx, citr );
+               add_delta( citr->from, citr->receiver, 0, result.second );
+               if ( result.first )
+                  cpu_idx.erase( citr );
+            } else {
+               auto result = process_expired_loan( net_idx, nitr );
+               add_delta( nitr->from, nitr->receiver, result.second, 0 );
+               if ( result.first )
+                  net_idx.erase( nitr );
+            }
          }
-      }
 
-      /// process net loans
-      {
-         rex_net_loan_table net_loans( get_self(), get_self().value );
-         auto net_idx = net_loans.get_index<"byexpr"_n>();
-         for ( uint16_t i = 0; i < max; ++i ) {
-            auto itr = net_idx.begin();
-            if ( itr == net_idx.end() || itr->expiration > current_time_point() ) break;
-
-            auto result = process_expired_loan( net_idx, itr );
-            if ( result.second != 0 )
-               update_resource_limits( itr->from, itr->receiver, result.second, 0 );
+         for ( const auto& [key, d] : deltas ) {
+            update_resource_limits( key.first, key.second, d.first, d.second );
+         }
 
-            if ( result.first )
-               net_idx.erase( itr );
+         if ( cpu_idx.begin() != cpu_idx.end() ) {
+            next_expiration = std::min( next_expiration, cpu_idx.begin()->expiration );
+         }
+         if ( net_idx.begin() != net_idx.end() ) {
+            next_expiration = std::min( next_expiration, net_idx.begin()->expiration );
          }
       }
 
       /// process sellrex orders
       if ( _rexorders.begin() != _rexorders.end() ) {
+         // fill against a copy of the pool and write the aggregate pool change once
+         rex_pool pool_state   = *pool;
+         bool     pool_changed = false;
          auto idx  = _rexorders.get_index<"bytime"_n>();
          auto oitr = idx.begin();
-         for ( uint16_t i = 0; i < max; ++i ) {
+         uint16_t limit = max;
+         for ( uint16_t i = 0; i < limit; ++i ) {
+            if ( i == max && max_extra > 0 ) {
+               uint16_t depth = 0;
+               for ( auto it = oitr; depth < 2 * max_extra && it != idx.end() && it->is_open; ++it ) ++depth;
+               limit += extra_budget( depth );
+               if ( i == limit ) break;
+            }
             if ( oitr == idx.end() || !oitr->is_open ) break;
+            if ( pool_state.available_unlent() < 0 ) break; // no queued order can be filled
             auto next = oitr;
             ++next;
             auto bitr = _rexbalance.find( oitr->owner.value );
             if ( bitr != _rexbalance.end() ) { // should always be true
-               auto result = fill_rex_order( bitr, oitr->rex_requested );
+               auto result = fill_rex_order( pool_state, bitr, oitr->rex_requested );
                if ( result.success ) {
+                  pool_changed = true;
                   const name order_owner = oitr->owner;
                   idx.modify( oitr, same_payer, [&]( auto& order ) {
                      order.proceeds.amount     = result.proceeds.amount;
@@ -624,8 +757,22 @@ namespace eosiosystem {
             }
             oitr = next;
          }
+         if ( pool_changed ) {
+            _rexpool.modify( pool, same_payer, [&]( auto& rt ) {
+               rt = pool_state;
+            });
+         }
+         pending_orders = idx.begin() != idx.end() && idx.begin()->is_open;
       }
 
+      // TELOS ADDITION
+      if ( !pool->next_loan_expiration.has_value() || pool->next_loan_expiration.value() != next_expiration ||
+           !pool->pending_orders.has_value() || pool->pending_orders.value() != pending_orders ) {
+         _rexpool.modify( pool, same_payer, [&]( auto& rt ) {
+            rt.next_loan_expiration.emplace( next_expiration );
+            rt.pending_orders.emplace( pending_orders );
+         });
+      }
    }
 
    /**
@@ -648,6 +795,8 @@ namespace eosiosystem {
          return;
       }
 
+      migrate_rex_return_buckets();
+
       const int64_t  current_rate      = ret_pool_elem->current_rate_of_increase;
       const uint32_t elapsed_intervals = get_elapsed_intervals( effective_time, ret_pool_elem->last_dist_time );
       int64_t        change_estimate   = current_rate * elapsed_intervals;
@@ -675,7 +824,7 @@ namespace eosiosystem {
 
          if ( new_return_bucket ) {
             _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
-               rb.return_buckets[new_bucket_time] = new_bucket_rate;
+               rb.ring.value().push_back( new_bucket_time, new_bucket_rate );
             });
          }
       }
@@ -685,23 +834,21 @@ namespace eosiosystem {
          int64_t expired_rate = 0;
          int64_t surplus      = 0;
          _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
-            auto& return_buckets = rb.return_buckets;
-            auto iter = return_buckets.begin();
-            while ( iter != return_buckets.end() && iter->first <= time_threshold ) {
-               auto next = iter;
-               ++next;
+            auto& ring = rb.ring.value();
+            while ( !ring.empty() && ring.front().time <= time_threshold ) {
+               const auto& bucket = ring.front();
                const uint32_t overtime = get_elapsed_intervals( effective_time,
-                                                                iter->first + seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval) );
-               surplus      += iter->second * overtime;
-               expired_rate += iter->second;
-               return_buckets.erase(iter);
-               iter = next;
+                                                                bucket.time + seconds(rex_return_pool::total_intervals * rex_return_pool::dist_interval) );
+               surplus      += bucket.rate * overtime;
+               expired_rate += bucket.rate;
+               ring.pop_front();
             }
          });
 
          _rexretpool.modify( ret_pool_elem, same_payer, [&]( auto& rp ) {
-            if ( !ret_buckets_elem->return_buckets.empty() ) {
-               rp.oldest_bucket_time = ret_buckets_elem->return_buckets.begin()->first;
+            const auto& ring = ret_buckets_elem->ring.value();
+            if ( !ring.empty() ) {
+               rp.oldest_bucket_time = ring.front().time;
             } else {
                rp.oldest_bucket_time = time_point_sec::min();
             }
@@ -733,7 +880,7 @@ namespace eosiosystem {
    template <typename T>
    int64_t system_contract::rent_rex( T& table, const name& from, const name& receiver, const asset& payment, const asset& fund )
    {
-      runrex(2);
+      runrex( 2, true );
 
       check( rex_loans_available(), "rex loans are currently not available" );
       check( payment.symbol == core_symbol() && fund.symbol == core_symbol(), "must use core token" );
@@ -782,9 +929,32 @@ namespace eosiosystem {
     */
    rex_order_outcome system_contract::fill_rex_order( const rex_balance_table::const_iterator& bitr, const asset& rex )
    {
-      auto rexitr = _rexpool.begin();
-      const int64_t S0 = rexitr->total_lendable.amount;
-      const int64_t R0 = rexitr->total_rex.amount;
+      rex_pool pool = *_rexpool.begin();
+      const auto result = fill_rex_order( pool, bitr, rex );
+      if ( result.success ) {
+         _rexpool.modify( _rexpool.begin(), same_payer, [&]( auto& rt ) {
+            rt = pool;
+         });
+      }
+      return result;
+   }
+
+   /**
+    * @brief Processes a sellrex order against a REX pool state that is written back by the caller
+    *
+    * Lets runrex fill a batch of queued orders with a single REX pool write.
+    *
+    * @param pool - REX pool state, updated in place if the order is filled
+    * @param bitr - iterator pointing to rex_balance database record
+    * @param rex - amount of rex to be sold
+    *
+    * @return rex_order_outcome - a struct containing success flag, order proceeds, and resultant
+    * vote stake change
+    */
+   rex_order_outcome system_contract::fill_rex_order( rex_pool& pool, const rex_balance_table::const_iterator& bitr, const asset& rex )
+   {
+      const int64_t S0 = pool.total_lendable.amount;
+      const int64_t R0 = pool.total_rex.amount;
       const int64_t p  = (uint128_t(rex.amount) * S0) / R0;
       const int64_t R1 = R0 - rex.amount;
       const int64_t S1 = S0 - p;
@@ -794,18 +964,14 @@ namespace eosiosystem {
 
       // mandel:
       // const int64_t unlent_lower_bound = rexitr->total_lent.amount / 10;
-      // TELOS SPECIFIC
-      const int64_t unlent_lower_bound = ( uint128_t(2) * rexitr->total_lent.amount ) / 10;
-
-      const int64_t available_unlent   = rexitr->total_unlent.amount - unlent_lower_bound; // available_unlent <= 0 is possible
+      // TELOS SPECIFIC: see rex_pool::available_unlent
+      const int64_t available_unlent = pool.available_unlent(); // available_unlent <= 0 is possible
       if ( proceeds.amount <= available_unlent ) {
          const int64_t init_vote_stake_amount = bitr->vote_stake.amount;
          const int64_t current_stake_value    = ( uint128_t(bitr->rex_balance.amount) * S0 ) / R0;
-         _rexpool.modify( rexitr, same_payer, [&]( auto& rt ) {
-            rt.total_rex.amount      = R1;
-            rt.total_lendable.amount = S1;
-            rt.total_unlent.amount   = rt.total_lendable.amount - rt.total_lent.amount;
-         });
+         pool.total_rex.amount      = R1;
+         pool.total_lendable.amount = S1;
+         pool.total_unlent.amount   = pool.total_lendable.amount - pool.total_lent.amount;
          _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
             rb.vote_stake.amount   = current_stake_value - proceeds.amount;
             rb.rex_balance.amount -= rex.amount;
@@ -995,15 +1161,89 @@ namespace eosiosystem {
     */
    void system_contract::process_rex_maturities( const rex_balance_table::const_iterator& bitr )
    {
+      // skip the row write when no bucket has matured
       const time_point_sec now = current_time_point();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         while ( !rb.rex_maturities.empty() && rb.rex_maturities.front().first <= now ) {
-            rb.matured_rex += rb.rex_maturities.front().second;
-            rb.rex_maturities.pop_front();
+      if ( bitr->version >= rex_balance::slots_version ) {
+         const auto& slots = bitr->maturity_slots.value();
+         if ( slots.empty() || slots[0].time > now ) {
+            return;
          }
+      } else if ( bitr->rex_maturities.empty() || bitr->rex_maturities.front().first > now ) {
+         return;
+      }
+      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+         process_rex_maturities( rb );
       });
    }
 
+   /**
+    * @brief Moves matured buckets of a REX balance into matured_rex, in place
+    *
+    * @param rb - rex_balance object being modified
+    */
+   void system_contract::process_rex_maturities( rex_balance& rb )
+   {
+      const time_point_sec now = current_time_point();
+      auto& slots = migrate_rex_maturities( rb );
+      while ( !slots.empty() && slots.front().time <= now ) {
+         rb.matured_rex += slots.front().rex;
+         slots.pop_front();
+      }
+   }
+
+   /**
+    * @brief Moves legacy REX maturity buckets into the fixed slots, in place
+    *
+    * Matured buckets go straight to matured_rex and the savings bucket to its own field,
+    * so the remaining daily buckets always fit.
+    *
+    * @param rb - rex_balance object being modified
+    *
+    * @return rex_maturity_slots& - maturity slots of the balance
+    */
+   rex_maturity_slots& system_contract::migrate_rex_maturities( rex_balance& rb )
+   {
+      if ( rb.version >= rex_balance::slots_version ) {
+         return rb.maturity_slots.value();
+      }
+
+      static const time_point_sec end_of_days = time_point_sec::maximum();
+      const time_point_sec now = current_time_point();
+      rex_maturity_slots slots;
+      for ( const auto& m : rb.rex_maturities ) {
+         if ( m.first == end_of_days ) {
+            slots.savings += m.second;
+         } else if ( m.first <= now ) {
+            rb.matured_rex += m.second;
+         } else {
+            slots.push_back( m.first, m.second );
+         }
+      }
+      rb.rex_maturities.clear();
+      rb.maturity_slots.emplace( slots );
+      rb.version = rex_balance::slots_version;
+      return rb.maturity_slots.value();
+   }
+
+   /**
+    * @brief Adds REX to the maturity bucket ending at maturity, in place
+    *
+    * Buckets are appended in maturity order, so only the last bucket can share the maturity.
+    *
+    * @param rb - rex_balance object being modified, with the savings bucket already read out
+    * @param maturity - maturity time of the bucket
+    * @param rex - amount of REX to be added
+    */
+   void system_contract::add_rex_maturity( rex_balance& rb, const time_point_sec& maturity, int64_t rex )
+   {
+      auto& slots = migrate_rex_maturities( rb );
+      if ( !slots.empty() && slots.back().time == maturity ) {
+         slots.back().rex += rex;
+      } else {
+         slots.push_back( maturity, rex );
+      }
+   }
+
    /**
     * @brief Consolidates REX maturity buckets into one
     *
@@ -1013,19 +1253,20 @@ namespace eosiosystem {
    void system_contract::consolidate_rex_balance( const rex_balance_table::const_iterator& bitr,
                                                   const asset& rex_in_sell_order )
    {
-      const int64_t rex_in_savings = read_rex_savings( bitr );
       _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
+         const int64_t rex_in_savings = read_rex_savings( rb );
          int64_t total  = rb.matured_rex - rex_in_sell_order.amount;
          rb.matured_rex = rex_in_sell_order.amount;
-         while ( !rb.rex_maturities.empty() ) {
-            total += rb.rex_maturities.front().second;
-            rb.rex_maturities.pop_front();
+         auto& slots    = migrate_rex_maturities( rb );
+         while ( !slots.empty() ) {
+            total += slots.front().rex;
+            slots.pop_front();
          }
          if ( total > 0 ) {
-            rb.rex_maturities.emplace_back( get_rex_maturity(), total );
+            slots.push_back( get_rex_maturity(), total );
          }
+         put_rex_savings( rb, rex_in_savings );
       });
-      put_rex_savings( bitr, rex_in_savings );
    }
 
    /**
@@ -1088,6 +1329,27 @@ namespace eosiosystem {
       return rex_received;
    }
 
+   /**
+    * @brief Moves the REX return buckets from the legacy map into the fixed-slot ring
+    */
+   void system_contract::migrate_rex_return_buckets()
+   {
+      const auto ret_buckets_elem = _rexretbuckets.begin();
+      if ( ret_buckets_elem == _rexretbuckets.end() || ret_buckets_elem->version >= rex_return_buckets::ring_version ) {
+         return;
+      }
+
+      _rexretbuckets.modify( ret_buckets_elem, same_payer, [&]( auto& rb ) {
+         rex_return_ring ring;
+         for ( const auto& bucket : rb.return_buckets ) {
+            ring.push_back( bucket.first, bucket.second );
+         }
+         rb.return_buckets.clear();
+         rb.ring.emplace( std::move(ring) );
+         rb.version = rex_return_buckets::ring_version;
+      });
+   }
+
    /**
     * @brief Adds an amount of core tokens to the REX return pool
     *
@@ -1112,7 +1374,10 @@ namespace eosiosystem {
             rp.pending_bucket_time     = effective_time;
             rp.proceeds                = fee.amount;
          });
-         _rexretbuckets.emplace( get_self(), [&]( auto& rb ) { } );
+         _rexretbuckets.emplace( get_self(), [&]( auto& rb ) {
+            rb.version = rex_return_buckets::ring_version;
+            rb.ring.emplace();
+         });
       } else {
          _rexretpool.modify( return_pool_elem, same_payer, [&]( auto& rp ) {
             rp.pending_bucket_proceeds += fee.amount;
@@ -1143,6 +1408,7 @@ namespace eosiosystem {
             rb.owner       = owner;
             rb.vote_stake  = payment;
             rb.rex_balance = rex_received;
+            add_rex_maturity( rb, get_rex_maturity(), rex_received.amount );
          });
          current_rex_stake.amount = payment.amount;
       } else {
@@ -1151,21 +1417,15 @@ namespace eosiosystem {
             rb.rex_balance.amount += rex_received.amount;
             rb.vote_stake.amount   = ( uint128_t(rb.rex_balance.amount) * _rexpool.begin()->total_lendable.amount )
                                      / _rexpool.begin()->total_rex.amount;
+
+            const int64_t rex_in_savings = read_rex_savings( rb );
+            process_rex_maturities( rb );
+            add_rex_maturity( rb, get_rex_maturity(), rex_received.amount );
+            put_rex_savings( rb, rex_in_savings );
          });
          current_rex_stake.amount = bitr->vote_stake.amount;
       }
 
-      const int64_t rex_in_savings = read_rex_savings( bitr );
-      process_rex_maturities( bitr );
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         const time_point_sec maturity = get_rex_maturity();
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == maturity ) {
-            rb.rex_maturities.back().second += rex_received.amount;
-         } else {
-            rb.rex_maturities.emplace_back( maturity, rex_received.amount );
-         }
-      });
-      put_rex_savings( bitr, rex_in_savings );
       return current_rex_stake - init_rex_stake;
    }
 
@@ -1176,40 +1436,28 @@ namespace eosiosystem {
     * allow uniform processing of remaining buckets as savings is a special case. This
     * function is used in conjunction with put_rex_savings.
     *
-    * @param bitr - iterator pointing to rex_balance object
+    * @param rb - rex_balance object being modified
     *
     * @return int64_t - amount of REX in savings bucket
     */
-   int64_t system_contract::read_rex_savings( const rex_balance_table::const_iterator& bitr )
+   int64_t system_contract::read_rex_savings( rex_balance& rb )
    {
-      int64_t rex_in_savings = 0;
-      static const time_point_sec end_of_days = time_point_sec::maximum();
-      if ( !bitr->rex_maturities.empty() && bitr->rex_maturities.back().first == end_of_days ) {
-         _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-            rex_in_savings = rb.rex_maturities.back().second;
-            rb.rex_maturities.pop_back();
-         });
-      }
+      auto& slots = migrate_rex_maturities( rb );
+      const int64_t rex_in_savings = slots.savings;
+      slots.savings = 0;
       return rex_in_savings;
    }
 
    /**
     * @brief Adds a specified REX amount to savings bucket
     *
-    * @param bitr - iterator pointing to rex_balance object
+    * @param rb - rex_balance object being modified
     * @param rex - amount of REX to be added
     */
-   void system_contract::put_rex_savings( const rex_balance_table::const_iterator& bitr, int64_t rex )
+   void system_contract::put_rex_savings( rex_balance& rb, int64_t rex )
    {
       if ( rex == 0 ) return;
-      static const time_point_sec end_of_days = time_point_sec::maximum();
-      _rexbalance.modify( bitr, same_payer, [&]( auto& rb ) {
-         if ( !rb.rex_maturities.empty() && rb.rex_maturities.back().first == end_of_days ) {
-            rb.rex_maturities.back().second += rex;
-         } else {
-            rb.rex_maturities.emplace_back( end_of_days, rex );
-         }
-      });
+      migrate_rex_maturities( rb ).savings += rex;
    }
 
    /**
@@ -22,59 +22,69 @@ namespace eosiosystem {
     return amountBlocksMissed > thresholdMissedBlocks;
   }
 
+  // producers_metric is kept sorted by name (it is built from the proposed schedule),
+  // so lookups are a binary search instead of a scan
+  producer_metric* system_contract::find_producer_metric(name producer) {
+    auto& metrics = _gschedule_metrics.producers_metric;
+    auto it = std::lower_bound(metrics.begin(), metrics.end(), producer, [](const producer_metric& pm, name n) {
+      return pm.bp_name < n;
+    });
+    return it != metrics.end() && it->bp_name == producer ? &*it : nullptr;
+  }
+
   void system_contract::reset_schedule_metrics(name producer = name(0)) {
-    for (auto &pm : _gschedule_metrics.producers_metric) {
-      if (producer != name(0) && pm.bp_name == producer) pm.missed_blocks_per_cycle = MAX_BLOCK_PER_CYCLE - 1;
-      else pm.missed_blocks_per_cycle = MAX_BLOCK_PER_CYCLE;
-    }
+    for (auto &pm : _gschedule_metrics.producers_metric) pm.missed_blocks_per_cycle = MAX_BLOCK_PER_CYCLE;
+
+    if (producer == name(0)) return;
+    if (auto pm = find_producer_metric(producer)) pm->missed_blocks_per_cycle = MAX_BLOCK_PER_CYCLE - 1;
   }
 
   void system_contract::update_producer_missed_blocks(name producer) {
-    for (auto &pm : _gschedule_metrics.producers_metric) {
-      if (pm.bp_name == producer && pm.missed_blocks_per_cycle > 0) {
-        pm.missed_blocks_per_cycle--;
-        break;
-      }
-    }
+    auto pm = find_producer_metric(producer);
+    if (pm != nullptr && pm->missed_blocks_per_cycle > 0) pm->missed_blocks_per_cycle--;
   }
 
-  bool system_contract::is_new_schedule_activated(name active_schedule[], uint32_t size) {
-    std::vector<name> new_schedule;
-    for (auto &p : _gschedule_metrics.producers_metric) new_schedule.emplace_back(p.bp_name);
+  // The cache is keyed on the header's schedule_version. At a switch the version and get_active_producers()
+  // can disagree for a block, so a version change re-reads the list on that block and once more on the next
+  void system_contract::refresh_active_schedule(uint32_t schedule_version) {
+    auto& metrics = _gschedule_metrics;
+    const bool cached = metrics.active_schedule.has_value() && metrics.active_schedule_version.has_value();
+    const bool version_changed = !cached || metrics.active_schedule_version.value() != schedule_version;
+    if (!version_changed && !metrics.active_schedule_pending.value_or(false)) return;
 
-    std::sort(new_schedule.begin(), new_schedule.end());
-    std::sort(active_schedule, active_schedule + size);
-
-    for (size_t i = 0; i < size; i++){
-      if (active_schedule[i] != new_schedule[i]) return false;
-    }
+    auto active_schedule = get_active_producers();
+    std::sort(active_schedule.begin(), active_schedule.end());
 
-    return true;
+    metrics.active_schedule_version.emplace(schedule_version);
+    metrics.active_schedule.emplace(std::move(active_schedule));
+    metrics.active_schedule_pending.emplace(version_changed);
   }
 
-  bool system_contract::is_new_schedule_activated(std::vector<name>& active_schedule) {
-    std::vector<name> new_schedule;
-    for (auto &p : _gschedule_metrics.producers_metric) new_schedule.emplace_back(p.bp_name);
+  // producers_metric is built from the proposed schedule, which is already sorted by name
+  bool system_contract::is_new_schedule_activated() {
+    const auto& active_schedule = _gschedule_metrics.active_schedule.value();
+    const auto& metrics = _gschedule_metrics.producers_metric;
 
-    std::sort(new_schedule.begin(), new_schedule.end());
-    std::sort(active_schedule.begin(), active_schedule.end());
+    if (_gstate.last_producer_schedule_size != active_schedule.size() || metrics.size() != active_schedule.size()) return false;
 
     for (size_t i = 0; i < active_schedule.size(); i++) {
-      if (active_schedule[i] != new_schedule[i]) return false;
+      if (active_schedule[i] != metrics[i].bp_name) return false;
     }
 
     return true;
   }
 
-  bool system_contract::check_missed_blocks(block_timestamp timestamp, name producer) {
+  bool system_contract::check_missed_blocks(block_timestamp timestamp, name producer, uint32_t schedule_version) {
     if (producer == "eosio"_n) {
       _gschedule_metrics.block_counter_correction++;
       _gschedule_metrics.last_onblock_caller = producer;
       return false;
     }
 
-    auto producers_schedule = get_active_producers();
-    bool is_activated = _gstate.last_producer_schedule_size == producers_schedule.size() && is_new_schedule_activated(producers_schedule);
+    refresh_active_schedule(schedule_version);
+    bool is_activated = is_new_schedule_activated();
+    // a proposed schedule is in flight, it becomes active without a version change in this block's header
+    if (!is_activated) _gschedule_metrics.active_schedule_pending.emplace(true);
 
     if (!is_activated) {
       if (_gschedule_metrics.last_onblock_caller != producer) _gschedule_metrics.block_counter_correction = 1;
@@ -84,11 +94,8 @@ namespace eosiosystem {
       return false;
     } else if (_gschedule_metrics.block_counter_correction > 0) {
       if (_gschedule_metrics.last_onblock_caller == "eosio"_n) {
-        for (auto &pm : _gschedule_metrics.producers_metric) {
-          if (pm.bp_name == producer) {
-            pm.missed_blocks_per_cycle -= uint32_t(_gschedule_metrics.block_counter_correction);
-            break;
-          }
+        if (auto pm = find_producer_metric(producer)) {
+          pm->missed_blocks_per_cycle -= uint32_t(_gschedule_metrics.block_counter_correction);
         }
       } else {
           reset_schedule_metrics();
@@ -115,18 +122,12 @@ namespace eosiosystem {
       return false;
     }
 
-    if (_gschedule_metrics.last_onblock_caller != producer) {
-      for (auto &pm : _gschedule_metrics.producers_metric) {
-        if (pm.bp_name == producer) {                       
-          if (pm.missed_blocks_per_cycle != MAX_BLOCK_PER_CYCLE) {        
-            _gschedule_metrics.last_onblock_caller = producer;
-            return true;
-          }
-          break;
-        }
-      }
+    auto pm = find_producer_metric(producer);
+    if (_gschedule_metrics.last_onblock_caller != producer && pm != nullptr && pm->missed_blocks_per_cycle != MAX_BLOCK_PER_CYCLE) {
+      _gschedule_metrics.last_onblock_caller = producer;
+      return true;
     }
-    
+
     update_producer_missed_blocks(producer);
     _gschedule_metrics.last_onblock_caller = producer;
 
@@ -149,6 +149,9 @@ namespace eosiosystem {
    void system_contract::update_elected_producers( const block_timestamp& block_time ) {
       _gstate.last_producer_schedule_update = block_time;
 
+      // TELOS ADDITION
+      fold_pending_votes();
+
       auto idx = _producers.get_index<"prototalvote"_n>();
 
       // BEGIN TELOS DELETION
@@ -213,7 +216,9 @@ namespace eosiosystem {
 
         _gschedule_metrics.producers_metric.erase( _gschedule_metrics.producers_metric.begin(), _gschedule_metrics.producers_metric.end());
         
+        // top_producers is sorted by name, find_producer_metric relies on that order
         std::vector<producer_metric> psm;
+        psm.reserve(top_producers.size());
         std::for_each(top_producers.begin(), top_producers.end(), [&psm](auto &tp) {
           auto bp_name = tp.producer_name;
           psm.emplace_back(producer_metric{ bp_name, 12 });
@@ -488,6 +493,11 @@ namespace eosiosystem {
       // END TELOS DELETION
       
       // BEGIN TELOS ADDITION
+      // the deltas below are relative to last_vote_weight, which pending proxy weight already includes
+      if(voter->is_proxy){
+         fold_pending_votes(voter_name);
+      }
+
       auto totalStaked = voter->staked;
       if(voter->is_proxy){
          totalStaked += voter->proxied_vote_weight;
@@ -694,12 +704,18 @@ namespace eosiosystem {
             
             propagate_weight_change(proxy);
          }
-      } else {
-         for (auto acnt : voter.producers) {
-            auto &pitr = _producers.get(acnt.value, "producer not found"); // data corruption
-            _producers.modify(pitr, same_payer, [&](auto &p) {
-               p.total_votes += delta;
-               _gstate.total_producer_vote_weight += delta;
+      } else if (delta != 0 && voter.producers.size() > 0) {
+         // defer the per-producer writes, repeated changes to the same proxy collapse into one row
+         pending_votes_table pending(get_self(), get_self().value);
+         auto pitr = pending.find(voter.owner.value);
+         if (pitr == pending.end()) {
+            pending.emplace(get_self(), [&](auto &pv) {
+               pv.voter = voter.owner;
+               pv.delta = delta;
+            });
+         } else {
+            pending.modify(pitr, same_payer, [&](auto &pv) {
+               pv.delta += delta;
             });
          }
       }
@@ -713,10 +729,41 @@ namespace eosiosystem {
 
    // BEGIN TELOS ADDITION
 
+   void system_contract::fold_pending_votes() {
+      pending_votes_table pending(get_self(), get_self().value);
+      for (auto pitr = pending.begin(); pitr != pending.end(); ) {
+         fold_pending_votes(pitr->voter);
+         pitr = pending.begin();
+      }
+   }
+
+   void system_contract::fold_pending_votes( const name& voter ) {
+      pending_votes_table pending(get_self(), get_self().value);
+      auto pitr = pending.find(voter.value);
+      if (pitr == pending.end()) return;
+
+      auto vitr = _voters.find(voter.value);
+      if (vitr != _voters.end()) {
+         for (auto acnt : vitr->producers) {
+            auto prod = _producers.find(acnt.value);
+            if (prod == _producers.end()) continue;
+            _producers.modify(prod, same_payer, [&](auto &p) {
+               p.total_votes += pitr->delta;
+               _gstate.total_producer_vote_weight += pitr->delta;
+            });
+         }
+      }
+      pending.erase(pitr);
+   }
+
    void system_contract::recalculate_votes(){
       if (_gstate.total_producer_vote_weight <= -0.1){ // -0.1 threshold for floating point calc ?
          _gstate.total_producer_vote_weight = 0;
          _gstate.total_activated_stake = 0;
+         pending_votes_table pending(get_self(), get_self().value);
+         for (auto pitr = pending.begin(); pitr != pending.end(); ) {
+            pitr = pending.erase(pitr);
+         }
          for(auto producer = _producers.begin(); producer != _producers.end(); ++producer){
             _producers.modify(producer, same_payer, [&](auto &p) {
                p.total_votes = 0;
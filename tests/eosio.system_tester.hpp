@@ -217,6 +217,74 @@ public:
       trx.sign( get_private_key( config::system_account_name, "active" ), control->get_chain_id()  );
       return push_transaction(trx);
    }
+
+   // onblock phase bits, mirrors `onblock_phase` in eosio.system.hpp
+   const std::vector<std::pair<std::string, uint32_t>> onblock_phases = {
+      { "missed_blocks", 1 }, { "producer_row", 2 }, { "recalculate_votes", 4 },
+      { "schedule_update", 8 }, { "name_bid_close", 16 }, { "rewards_snapshot", 32 }
+   };
+
+   // true when the system contract was built with the SYSTEM_PROFILE option
+   bool has_onblock_profiler() {
+      return !abi_ser.get_action_type( "setprofmask"_n ).empty();
+   }
+
+   action_result setprofmask( uint32_t disabled_phases ) {
+      return push_action( config::system_account_name, "setprofmask"_n, mvo()("disabled_phases", disabled_phases) );
+   }
+
+   // runs `blocks` onblocks with the given phases masked out and counts, per phase, the blocks in which it
+   // ran according to the PROF{mask} console line; onblock cannot time its phases, so only counts are reported
+   std::map<std::string, uint32_t> count_onblock_phases( uint32_t blocks, uint32_t disabled_phases = 0 ) {
+      BOOST_REQUIRE_EQUAL( success(), setprofmask( disabled_phases ) );
+      std::map<std::string, uint32_t> runs;
+      for( const auto& phase : onblock_phases ) runs[phase.first] = 0;
+      for( uint32_t i = 0; i < blocks; ++i ) {
+         auto trace = on_block();
+         const auto& console = trace->action_traces[0].console;
+         auto pos = console.rfind( "PROF{" );
+         BOOST_REQUIRE( pos != std::string::npos );
+         const uint32_t ran = std::stoul( console.substr( pos + 5 ) );
+         for( const auto& phase : onblock_phases )
+            if( ran & phase.second ) ++runs[phase.first];
+         produce_block();
+      }
+      BOOST_REQUIRE_EQUAL( success(), setprofmask( 0 ) );
+      return runs;
+   }
+
+   // queues one sellrex order from each of `count` new accounts while a large cpu loan keeps
+   // most of the rex pool lent out, returns the sellers in queue order
+   std::vector<account_name> queue_sellrex_orders( uint32_t count ) {
+      const account_name whale  = "rexwhale1111"_n;
+      const account_name renter = "rexrenter111"_n;
+      setup_rex_accounts( { whale, renter }, core_sym::from_string("10000000.0000") );
+      BOOST_REQUIRE_EQUAL( success(), buyrex( whale, core_sym::from_string("10000000.0000") ) );
+
+      std::vector<account_name> sellers;
+      sellers.reserve( count );
+      for( uint32_t i = 0; i < count; ++i ) {
+         std::string n = "sellrex";
+         for( uint32_t v = i, d = 0; d < 5; ++d, v /= 31 ) {
+            n += "abcdefghijklmnopqrstuvwxyz12345"[v % 31];
+         }
+         sellers.emplace_back( n );
+      }
+      setup_rex_accounts( sellers, core_sym::from_string("10.0000") );
+      for( const auto& seller : sellers ) {
+         BOOST_REQUIRE_EQUAL( success(), buyrex( seller, core_sym::from_string("10.0000") ) );
+      }
+
+      // lends out about 90% of the pool, leaving no unlent tokens above the 20% reserve
+      BOOST_REQUIRE_EQUAL( success(), rentcpu( renter, renter, core_sym::from_string("200000.0000") ) );
+      produce_block( fc::days(5) );
+      produce_blocks( 2 );
+      for( const auto& seller : sellers ) {
+         BOOST_REQUIRE_EQUAL( success(), sellrex( seller, get_rex_balance( seller ) ) );
+         BOOST_REQUIRE( get_rex_order( seller )["is_open"].as<bool>() );
+      }
+      return sellers;
+   }
    // END TELOS ADDITIONS
 
    transaction_trace_ptr create_account_with_resources( account_name a, account_name creator, asset ramfunds, bool multisig,
@@ -350,6 +418,18 @@ public:
       return stake( account_name(from), account_name(to), net, cpu );
    }
 
+   action_result delegatebatch( const account_name& from, const vector<std::tuple<account_name, asset, asset>>& delegations, bool transfer = false ) {
+      fc::variants dels;
+      for( const auto& [receiver, net, cpu] : delegations ) {
+         dels.push_back( mvo()("receiver", receiver)("stake_net_quantity", net)("stake_cpu_quantity", cpu) );
+      }
+      return push_action( name(from), "delegatebatch"_n, mvo()
+                          ("from",        from)
+                          ("delegations", dels)
+                          ("transfer",    transfer)
+      );
+   }
+
    action_result stake( const account_name& acnt, const asset& net, const asset& cpu ) {
       return stake( acnt, acnt, net, cpu );
    }
@@ -396,6 +476,14 @@ public:
       return unstake( account_name(acnt), net, cpu );
    }
 
+   action_result refund( const account_name& owner ) {
+      return push_action( owner, "refund"_n, mvo()("owner", owner) );
+   }
+
+   action_result refundexec( const account_name& user, uint16_t max, const std::vector<account_name>& skip = {} ) {
+      return push_action( user, "refundexec"_n, mvo()("user", user)("max", max)("skip", skip) );
+   }
+
    int64_t bancor_convert( int64_t S, int64_t R, int64_t T ) { return double(R) * T  / ( double(S) + T ); };
 
    int64_t get_net_limit( account_name a ) {
@@ -431,6 +519,16 @@ public:
       );
    }
 
+   fc::variant getrexpos( const account_name& owner ) {
+      auto trace = base_tester::push_action( config::system_account_name, "getrexpos"_n, owner, mvo()("owner", owner) );
+      return abi_ser.binary_to_variant( "rex_position", trace->action_traces[0].return_value, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
+   fc::variant getrexprice() {
+      auto trace = base_tester::push_action( config::system_account_name, "getrexprice"_n, config::system_account_name, mvo() );
+      return abi_ser.binary_to_variant( "rex_price", trace->action_traces[0].return_value, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
    asset get_buyrex_result( const account_name& from, const asset& amount ) {
       auto trace = base_tester::push_action( config::system_account_name, "buyrex"_n, from, mvo()("from", from)("amount", amount) );
       asset rex_received;
@@ -925,6 +1023,11 @@ public:
       return get_total_stake( account_name(act) );
    }
 
+   fc::variant get_rammarket() {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "rammarket"_n, account_name(symbol(SY(4,RAMCORE)).value()) );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "exchange_state", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
    fc::variant get_voter_info( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "voters"_n, act );
       return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "voter_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
@@ -933,6 +1036,29 @@ public:
       return get_voter_info( account_name(act) );
    }
 
+   fc::variant get_pending_vote( const account_name& voter ) {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "pendvotes"_n, voter );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "pending_vote_delta", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
+   // regproxy rejects isproxy on Telos, but proxies registered before it was disabled keep is_proxy set;
+   // gives `proxy`'s voters row that state by rewriting it in the chain database
+   void set_legacy_proxy( const account_name& proxy ) {
+      namespace chain = eosio::chain;
+      auto& db = const_cast<chainbase::database&>( control->db() );
+      const auto* t_id = db.find<chain::table_id_object, chain::by_code_scope_table>( boost::make_tuple( config::system_account_name, config::system_account_name, "voters"_n ) );
+      BOOST_REQUIRE( t_id != nullptr );
+      const auto* row = db.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple( t_id->id, proxy.to_uint64_t() ) );
+      BOOST_REQUIRE( row != nullptr );
+
+      mvo voter( get_voter_info( proxy ).get_object() );
+      voter["is_proxy"] = true;
+      const auto data = abi_ser.variant_to_binary( "voter_info", voter, abi_serializer::create_yield_function(abi_serializer_max_time) );
+      db.modify( *row, [&]( auto& kv ) {
+         kv.value.assign( data.data(), data.size() );
+      });
+   }
+
    fc::variant get_producer_info( const account_name& act ) {
       vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "producers"_n, act );
       return abi_ser.binary_to_variant( "producer_info", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
@@ -1126,6 +1252,11 @@ public:
       return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "refund_request", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
    }
 
+   fc::variant get_refund_queue_entry( name owner ) {
+      vector<char> data = get_row_by_account( config::system_account_name, config::system_account_name, "refundq"_n, owner );
+      return data.empty() ? fc::variant() : abi_ser.binary_to_variant( "refund_queue_entry", data, abi_serializer::create_yield_function(abi_serializer_max_time) );
+   }
+
    abi_serializer initialize_multisig() {
       abi_serializer msig_abi_ser;
       {
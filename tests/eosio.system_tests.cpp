@@ -0,0 +1,634 @@
+#include <boost/test/unit_test.hpp>
+#include <eosio/chain/contract_table_objects.hpp>
+#include <eosio/chain/global_property_object.hpp>
+#include <eosio/chain/resource_limits.hpp>
+#include <eosio/chain/wast_to_wasm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fc/log/logger.hpp>
+#include <eosio/chain/exceptions.hpp>
+
+#include "eosio.system_tester.hpp"
+
+using namespace eosio_system;
+using namespace std;
+
+
+BOOST_AUTO_TEST_SUITE(eosio_system_tests)
+
+BOOST_FIXTURE_TEST_CASE( active_schedule_cache_follows_schedule, eosio_system_tester ) try {
+    auto producer_names = active_and_vote_producers();
+
+    auto cached_schedule = [&]() {
+        vector<name> names;
+        for( const auto& n : get_gmetrics_state()["active_schedule"].get_array() ) names.push_back( n.as<name>() );
+        return names;
+    };
+    auto head_schedule = [&]() {
+        vector<name> names;
+        for( const auto& p : control->head_block_state()->active_schedule.producers ) names.push_back( p.producer_name );
+        std::sort( names.begin(), names.end() );
+        return names;
+    };
+
+    // on a stable schedule the cache matches the active producers and is not re-read
+    produce_blocks( 2 );
+    const uint32_t version = control->head_block_state()->active_schedule.version;
+    BOOST_REQUIRE_EQUAL( version, get_gmetrics_state()["active_schedule_version"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( false, get_gmetrics_state()["active_schedule_pending"].as<bool>() );
+    BOOST_REQUIRE( head_schedule() == cached_schedule() );
+
+    for( int i = 0; i < 200; ++i ) {
+        produce_block();
+        auto metrics = get_gmetrics_state();
+        BOOST_REQUIRE_EQUAL( version, metrics["active_schedule_version"].as<uint32_t>() );
+        BOOST_REQUIRE_EQUAL( false, metrics["active_schedule_pending"].as<bool>() );
+    }
+
+    // dropping a producer proposes a new schedule, the cache follows it once it becomes active
+    const name dropped = producer_names[10];
+    BOOST_REQUIRE_EQUAL( success(), push_action( dropped, "unregprod"_n, mvo()("producer", dropped) ) );
+    for( int i = 0; i < 2000 && control->head_block_state()->active_schedule.version == version; ++i ) {
+        produce_block();
+        BOOST_REQUIRE_EQUAL( version, get_gmetrics_state()["active_schedule_version"].as<uint32_t>() );
+    }
+    BOOST_REQUIRE_EQUAL( version + 1, control->head_block_state()->active_schedule.version );
+
+    produce_blocks( 2 );
+    auto metrics = get_gmetrics_state();
+    BOOST_REQUIRE_EQUAL( version + 1, metrics["active_schedule_version"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( false, metrics["active_schedule_pending"].as<bool>() );
+    auto cached = cached_schedule();
+    BOOST_REQUIRE( head_schedule() == cached );
+    BOOST_REQUIRE( std::find( cached.begin(), cached.end(), dropped ) == cached.end() );
+
+    auto producers_metric = metrics["producers_metric"].get_array();
+    BOOST_REQUIRE_EQUAL( cached.size(), producers_metric.size() );
+    for( size_t i = 0; i < cached.size(); ++i ) {
+        BOOST_REQUIRE_EQUAL( producers_metric[i]["bp_name"].as<name>(), cached[i] );
+    }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( onblock_phase_profile, eosio_system_tester ) try {
+    if( !has_onblock_profiler() ) {
+        BOOST_TEST_MESSAGE( "eosio.system built without EOSIO_SYSTEM_PROFILE, skipping onblock phase profile" );
+        return;
+    }
+    active_and_vote_producers();
+
+    // 8000 blocks cover more than one rewards snapshot (3600 slots) and many schedule updates
+    auto runs = count_onblock_phases( 8000 );
+    BOOST_REQUIRE_EQUAL( 8000, runs.at("missed_blocks") );
+    BOOST_REQUIRE_EQUAL( 8000, runs.at("producer_row") );
+    BOOST_REQUIRE_EQUAL( 8000, runs.at("recalculate_votes") );
+    BOOST_REQUIRE( runs.at("schedule_update") > 0 );
+    BOOST_REQUIRE( runs.at("schedule_update") < 8000 );
+    BOOST_REQUIRE( runs.at("rewards_snapshot") > 0 );
+
+    // a masked phase does not run, the others are unaffected
+    runs = count_onblock_phases( 100, 4 /* recalculate_votes */ );
+    BOOST_REQUIRE_EQUAL( 0, runs.at("recalculate_votes") );
+    BOOST_REQUIRE_EQUAL( 100, runs.at("missed_blocks") );
+    BOOST_REQUIRE_EQUAL( 100, runs.at("producer_row") );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( pending_proxy_votes_fold_like_eager_updates, eosio_system_tester ) try {
+    auto producer_names = active_and_vote_producers();
+    const account_name proxy = "proxyvoter11"_n, alice = "delegatora11"_n, bob = "delegatorb11"_n;
+    setup_rex_accounts( { proxy, alice, bob }, core_sym::from_string("100000.0000"), core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+
+    const std::vector<account_name> voted = { producer_names[0], producer_names[1], producer_names[2] };
+    BOOST_REQUIRE_EQUAL( success(), vote( proxy, voted ) );
+    set_legacy_proxy( proxy );
+    produce_blocks( 2 );
+
+    auto total_votes  = [&]( const account_name& p ) { return get_producer_info( p )["total_votes"].as_double(); };
+    auto vote_weight  = [&]( const account_name& v ) { return get_voter_info( v )["last_vote_weight"].as_double(); };
+    auto total_weight = [&]() { return get_global_state()["total_producer_vote_weight"].as_double(); };
+
+    std::vector<double> before;
+    for( const auto& p : voted ) before.push_back( total_votes( p ) );
+    const double weight_before = vote_weight( proxy );
+    const double total_before  = total_weight();
+
+    // delegating to the proxy and changing stake within one round only touch the proxy's pendvotes row
+    BOOST_REQUIRE_EQUAL( success(), vote( alice, {}, proxy ) );
+    BOOST_REQUIRE_EQUAL( success(), vote( bob, {}, proxy ) );
+    BOOST_REQUIRE_EQUAL( success(), stake( alice, alice, core_sym::from_string("20000.0000"), core_sym::from_string("20000.0000") ) );
+    BOOST_REQUIRE_EQUAL( success(), stake( bob, bob, core_sym::from_string("5000.0000"), core_sym::from_string("5000.0000") ) );
+    BOOST_REQUIRE_EQUAL( success(), unstake( bob, bob, core_sym::from_string("2000.0000"), core_sym::from_string("2000.0000") ) );
+
+    const double weight_after = vote_weight( proxy );
+    BOOST_REQUIRE( weight_after > weight_before );
+    BOOST_REQUIRE_EQUAL( double( get_voter_info( alice )["staked"].as_int64() + get_voter_info( bob )["staked"].as_int64() ),
+                         get_voter_info( proxy )["proxied_vote_weight"].as_double() );
+    BOOST_REQUIRE_SMALL( get_pending_vote( proxy )["delta"].as_double() - (weight_after - weight_before), 1.0 );
+    for( size_t i = 0; i < voted.size(); ++i ) {
+        BOOST_REQUIRE_EQUAL( before[i], total_votes( voted[i] ) );
+    }
+    BOOST_REQUIRE_EQUAL( total_before, total_weight() );
+
+    // the next schedule update folds the row, leaving the totals the eager per-change updates would have
+    produce_blocks( 250 );
+    BOOST_REQUIRE( get_pending_vote( proxy ).is_null() );
+    BOOST_REQUIRE_EQUAL( weight_after, vote_weight( proxy ) );
+    for( size_t i = 0; i < voted.size(); ++i ) {
+        BOOST_REQUIRE_SMALL( total_votes( voted[i] ) - before[i] - (weight_after - weight_before), 1.0 );
+    }
+    BOOST_REQUIRE_SMALL( total_weight() - total_before - voted.size() * (weight_after - weight_before), 1.0 );
+
+    // a proxy changing its own vote first applies its pending weight, then moves all of it
+    BOOST_REQUIRE_EQUAL( success(), stake( alice, alice, core_sym::from_string("10000.0000"), core_sym::from_string("10000.0000") ) );
+    BOOST_REQUIRE( !get_pending_vote( proxy ).is_null() );
+
+    const std::vector<account_name> revoted = { producer_names[1], producer_names[2], producer_names[3] };
+    std::vector<double> before_revote;
+    for( const auto& p : { producer_names[0], producer_names[1], producer_names[2], producer_names[3] } ) before_revote.push_back( total_votes( p ) );
+    const double total_before_revote = total_weight();
+
+    BOOST_REQUIRE_EQUAL( success(), vote( proxy, revoted ) );
+    BOOST_REQUIRE( get_pending_vote( proxy ).is_null() );
+    const double weight_revoted = vote_weight( proxy );
+    BOOST_REQUIRE_SMALL( total_votes( producer_names[0] ) - (before_revote[0] - weight_after), 1.0 );
+    BOOST_REQUIRE_SMALL( total_votes( producer_names[1] ) - (before_revote[1] - weight_after + weight_revoted), 1.0 );
+    BOOST_REQUIRE_SMALL( total_votes( producer_names[2] ) - (before_revote[2] - weight_after + weight_revoted), 1.0 );
+    BOOST_REQUIRE_SMALL( total_votes( producer_names[3] ) - (before_revote[3] + weight_revoted), 1.0 );
+    BOOST_REQUIRE_SMALL( total_weight() - (total_before_revote + 3 * (weight_revoted - weight_after)), 1.0 );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( claimrewards_snapshot_folds_pending_proxy_votes, eosio_system_tester ) try {
+    auto producer_names = active_and_vote_producers();
+    const account_name proxy = "proxyvoter11"_n, alice = "delegatora11"_n;
+    setup_rex_accounts( { proxy, alice }, core_sym::from_string("100000.0000"), core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+
+    const std::vector<account_name> voted = { producer_names[0], producer_names[1] };
+    BOOST_REQUIRE_EQUAL( success(), vote( proxy, voted ) );
+    set_legacy_proxy( proxy );
+    produce_blocks( 2 );
+
+    // wait for the last schedule update before a rewards snapshot, so the snapshot is the next fold
+    auto next_snapshot = [&]() { return get_global_state()["last_claimrewards"].as<uint32_t>() + 3600; };
+    auto next_update   = [&]() { return get_global_state()["last_producer_schedule_update"].as<block_timestamp_type>().slot + 121; };
+    for( int i = 0; i < 8000; ++i ) {
+        const uint32_t head_slot = control->head_block_header().timestamp.slot;
+        if( next_snapshot() > head_slot + 2 && next_snapshot() < next_update() ) break;
+        produce_block();
+    }
+    const uint32_t head_slot = control->head_block_header().timestamp.slot;
+    BOOST_REQUIRE( next_snapshot() > head_slot + 2 && next_snapshot() < next_update() );
+
+    const double votes_before  = get_producer_info( voted[0] )["total_votes"].as_double();
+    const double weight_before = get_voter_info( proxy )["last_vote_weight"].as_double();
+    BOOST_REQUIRE_EQUAL( success(), vote( alice, {}, proxy ) );
+    BOOST_REQUIRE_EQUAL( success(), stake( alice, alice, core_sym::from_string("20000.0000"), core_sym::from_string("20000.0000") ) );
+    const double weight_after = get_voter_info( proxy )["last_vote_weight"].as_double();
+    BOOST_REQUIRE( !get_pending_vote( proxy ).is_null() );
+
+    const auto last_update    = get_global_state()["last_producer_schedule_update"].as<block_timestamp_type>();
+    const uint32_t last_claim = get_global_state()["last_claimrewards"].as<uint32_t>();
+    for( int i = 0; i < 200 && get_global_state()["last_claimrewards"].as<uint32_t>() == last_claim; ++i ) {
+        produce_block();
+    }
+
+    // the snapshot ran mid-round: no schedule update since the change, yet producers carry the proxy's weight
+    BOOST_REQUIRE( get_global_state()["last_claimrewards"].as<uint32_t>() != last_claim );
+    BOOST_REQUIRE( get_global_state()["last_producer_schedule_update"].as<block_timestamp_type>() == last_update );
+    BOOST_REQUIRE( get_pending_vote( proxy ).is_null() );
+    BOOST_REQUIRE_SMALL( get_producer_info( voted[0] )["total_votes"].as_double() - votes_before - (weight_after - weight_before), 1.0 );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( top_bid_cached_in_global_state, eosio_system_tester ) try {
+    active_and_vote_producers();
+    transfer( config::system_account_name, "alice1111111"_n, core_sym::from_string("100.0000") );
+    transfer( config::system_account_name, "bob111111111"_n, core_sym::from_string("100.0000") );
+
+    BOOST_REQUIRE_EQUAL( success(), bidname( "alice1111111"_n, "prefa"_n, core_sym::from_string("1.0000") ) );
+    auto gstate = get_global_state();
+    BOOST_REQUIRE_EQUAL( "prefa"_n, gstate["top_bid_name"].as<name>() );
+    BOOST_REQUIRE_EQUAL( 10000, gstate["top_bid_amount"].as<int64_t>() );
+
+    BOOST_REQUIRE_EQUAL( success(), bidname( "bob111111111"_n, "prefb"_n, core_sym::from_string("2.0000") ) );
+    BOOST_REQUIRE_EQUAL( "prefb"_n, get_global_state()["top_bid_name"].as<name>() );
+
+    // a lower bid does not displace the top, outbidding on the same name does
+    BOOST_REQUIRE_EQUAL( success(), bidname( "alice1111111"_n, "prefc"_n, core_sym::from_string("1.5000") ) );
+    BOOST_REQUIRE_EQUAL( "prefb"_n, get_global_state()["top_bid_name"].as<name>() );
+    BOOST_REQUIRE_EQUAL( success(), bidname( "bob111111111"_n, "prefa"_n, core_sym::from_string("3.0000") ) );
+    gstate = get_global_state();
+    BOOST_REQUIRE_EQUAL( "prefa"_n, gstate["top_bid_name"].as<name>() );
+    BOOST_REQUIRE_EQUAL( 30000, gstate["top_bid_amount"].as<int64_t>() );
+
+    // once the top auction closes the cache moves on to the next highest open bid
+    produce_block( fc::days(15) );
+    produce_blocks( 250 );
+    gstate = get_global_state();
+    BOOST_REQUIRE_EQUAL( "prefb"_n, gstate["top_bid_name"].as<name>() );
+    BOOST_REQUIRE_EQUAL( 20000, gstate["top_bid_amount"].as<int64_t>() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( rex_return_buckets_migration, eosio_system_tester ) try {
+    // Telos channels fees straight to the rex pool, so a fresh chain never creates return buckets
+    BOOST_REQUIRE( get_rex_return_buckets().is_null() );
+    BOOST_REQUIRE_EQUAL( wasm_assert_msg("nothing to migrate"),
+                         push_action( config::system_account_name, "migrbuckets"_n, mvo() ) );
+    BOOST_REQUIRE_EQUAL( error("missing authority of eosio"),
+                         push_action( "alice1111111"_n, "migrbuckets"_n, mvo() ) );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( rex_maturities_updated_in_place, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const account_name alice = "aliceaccount"_n;
+    setup_rex_accounts( { alice }, init_balance );
+
+    // live bucket `i` of the fixed maturity slots, counted from the head
+    auto bucket = []( const fc::variant& slots, uint32_t i ) {
+       const uint32_t head = slots["head"].as<uint32_t>();
+       const auto& all = slots["slots"].get_array();
+       return all[(head + i) % all.size()];
+    };
+
+    // purchases on the same day share one maturity bucket
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("100.0000") ) );
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("100.0000") ) );
+    auto rex_bal = get_rex_balance_obj( alice );
+    const int64_t total_rex = rex_bal["rex_balance"].as<asset>().get_amount();
+    BOOST_REQUIRE_EQUAL( 1, rex_bal["version"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( 0, rex_bal["rex_maturities"].get_array().size() );
+    auto slots = rex_bal["maturity_slots"];
+    BOOST_REQUIRE_EQUAL( 6, slots["slots"].get_array().size() );
+    BOOST_REQUIRE_EQUAL( 1, slots["size"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( total_rex, bucket( slots, 0 )["rex"].as<int64_t>() );
+
+    // savings are kept beside the daily buckets across moves and purchases
+    const asset to_savings = asset( total_rex / 4, symbol(SY(4, REX)) );
+    BOOST_REQUIRE_EQUAL( success(), mvtosavings( alice, to_savings ) );
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("100.0000") ) );
+    slots = get_rex_balance_obj( alice )["maturity_slots"];
+    BOOST_REQUIRE_EQUAL( 1, slots["size"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( to_savings.get_amount(), slots["savings"].as<int64_t>() );
+
+    BOOST_REQUIRE_EQUAL( success(), mvfrsavings( alice, to_savings ) );
+    slots = get_rex_balance_obj( alice )["maturity_slots"];
+    BOOST_REQUIRE_EQUAL( 1, slots["size"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( 0, slots["savings"].as<int64_t>() );
+
+    // a purchase on a later day opens a second bucket
+    produce_block( fc::days(1) );
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("100.0000") ) );
+    slots = get_rex_balance_obj( alice )["maturity_slots"];
+    BOOST_REQUIRE_EQUAL( 2, slots["size"].as<uint32_t>() );
+    BOOST_REQUIRE( bucket( slots, 0 )["time"].as<time_point_sec>() < bucket( slots, 1 )["time"].as<time_point_sec>() );
+
+    // everything matures after five more days
+    produce_block( fc::days(5) );
+    produce_blocks( 2 );
+    BOOST_REQUIRE_EQUAL( success(), updaterex( alice ) );
+    rex_bal = get_rex_balance_obj( alice );
+    BOOST_REQUIRE_EQUAL( 0, rex_bal["maturity_slots"]["size"].as<uint32_t>() );
+    BOOST_REQUIRE_EQUAL( rex_bal["rex_balance"].as<asset>().get_amount(), rex_bal["matured_rex"].as<int64_t>() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( runrex_watermarks, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+    const account_name alice = accounts[0], bob = accounts[1];
+    setup_rex_accounts( accounts, init_balance );
+
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("500.0000") ) );
+    BOOST_REQUIRE_EQUAL( success(), rentcpu( bob, bob, core_sym::from_string("10.0000") ) );
+
+    // the watermark tracks the only loan, no sell orders are queued
+    const time_point expiration = control->head_block_time() + fc::days(30);
+    auto pool = get_rex_pool();
+    BOOST_REQUIRE_EQUAL( expiration, pool["next_loan_expiration"].as<time_point>() );
+    BOOST_REQUIRE_EQUAL( false, pool["pending_orders"].as<bool>() );
+
+    // once the loan expires runrex processes it and resets the watermark
+    produce_block( fc::days(30) );
+    produce_blocks( 2 );
+    BOOST_REQUIRE_EQUAL( success(), rexexec( alice, 2 ) );
+    pool = get_rex_pool();
+    BOOST_REQUIRE_EQUAL( time_point::maximum(), pool["next_loan_expiration"].as<time_point>() );
+    BOOST_REQUIRE_EQUAL( 0, pool["total_lent"].as<asset>().get_amount() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( sellrex_queue_fills_in_batches, eosio_system_tester ) try {
+    const uint32_t orders  = 250;
+    const uint16_t batch   = 100;
+    const auto     sellers = queue_sellrex_orders( orders );
+
+    // the loan expires without renewal, which frees enough unlent tokens for every order
+    produce_block( fc::days(30) );
+    produce_blocks( 2 );
+
+    // each rexexec pass fills the next `batch` orders in queue order and leaves the rest open
+    for( uint32_t filled = 0; filled < orders; ) {
+        BOOST_REQUIRE_EQUAL( true, get_rex_pool()["pending_orders"].as<bool>() );
+        BOOST_REQUIRE_EQUAL( success(), rexexec( sellers.front(), batch ) );
+        filled = std::min( orders, filled + batch );
+        for( uint32_t i = 0; i < orders; ++i ) {
+            BOOST_REQUIRE_EQUAL( i >= filled, get_rex_order( sellers[i] )["is_open"].as<bool>() );
+        }
+    }
+    BOOST_REQUIRE_EQUAL( false, get_rex_pool()["pending_orders"].as<bool>() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( ram_bancor_integer_conversion, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("100000.0000");
+    const account_name alice = "aliceaccount"_n;
+    setup_rex_accounts( { alice }, init_balance, core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+
+    // the former double based formula, the integer one must agree with it to within one unit
+    auto double_output = []( int64_t ib, int64_t ob, int64_t in ) {
+       return int64_t( (double(in) * double(ob)) / (double(ib) + double(in)) );
+    };
+    auto exact_output = []( int64_t ib, int64_t ob, int64_t in ) {
+       return int64_t( (__uint128_t(in) * uint64_t(ob)) / (uint64_t(ib) + uint64_t(in)) );
+    };
+    auto ram_bytes = [&]() { return get_total_stake( alice )["ram_bytes"].as_int64(); };
+    auto reserves  = [&]() {
+       auto market = get_rammarket();
+       return std::make_pair( market["base"]["balance"].as<asset>().get_amount(),
+                              market["quote"]["balance"].as<asset>().get_amount() );
+    };
+
+    const uint32_t trades = 200;
+    int64_t amount = 10000;
+    for( uint32_t i = 0; i < trades; ++i, amount = amount * 7 / 5 % 10000000 + 10000 ) {
+       // buyram: reconstruct the reserves seen by the conversion from the resulting row
+       int64_t bytes = ram_bytes();
+       auto [ base, quote ] = reserves();
+       BOOST_REQUIRE_EQUAL( success(), buyram( alice, alice, asset( amount, symbol{CORE_SYM} ) ) );
+       const int64_t bytes_out = ram_bytes() - bytes;
+       auto [ base_after, quote_after ] = reserves();
+       const int64_t tokens_in = quote_after - quote;
+       BOOST_REQUIRE_EQUAL( bytes_out, exact_output( quote, base_after + bytes_out, tokens_in ) );
+       BOOST_REQUIRE( std::abs( bytes_out - double_output( quote, base_after + bytes_out, tokens_in ) ) <= 1 );
+
+       // sellram: half of what was just bought
+       const int64_t sell_bytes = bytes_out / 2;
+       std::tie( base, quote ) = reserves();
+       BOOST_REQUIRE_EQUAL( success(), sellram( alice, sell_bytes ) );
+       std::tie( base_after, quote_after ) = reserves();
+       const int64_t tokens_out = quote - quote_after;
+       BOOST_REQUIRE_EQUAL( tokens_out, exact_output( base_after - sell_bytes, quote, sell_bytes ) );
+       BOOST_REQUIRE( std::abs( tokens_out - double_output( base_after - sell_bytes, quote, sell_bytes ) ) <= 1 );
+    }
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( delegatebatch_stakes_many_receivers, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n, "danaaccount1"_n };
+    const account_name alice = accounts[0], bob = accounts[1], carol = accounts[2], dana = accounts[3];
+    setup_rex_accounts( accounts, init_balance, core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+
+    const asset net = core_sym::from_string("3.0000"), cpu = core_sym::from_string("7.0000");
+    const int64_t staked    = get_voter_info( alice )["staked"].as_int64();
+    const asset   bob_net   = get_total_stake( bob )["net_weight"].as<asset>();
+    const asset   bob_cpu   = get_total_stake( bob )["cpu_weight"].as<asset>();
+
+    BOOST_REQUIRE_EQUAL( wasm_assert_msg("no delegations"), delegatebatch( alice, {} ) );
+    BOOST_REQUIRE_EQUAL( wasm_assert_msg("cannot delegate to self in a batch"),
+                         delegatebatch( alice, { { bob, net, cpu }, { alice, net, cpu } } ) );
+    BOOST_REQUIRE_EQUAL( wasm_assert_msg("must stake a positive amount"),
+                         delegatebatch( alice, { { bob, net, cpu }, { carol, core_sym::from_string("0.0000"), core_sym::from_string("0.0000") } } ) );
+
+    // one transfer for the total, alice keeps the voting power
+    BOOST_REQUIRE_EQUAL( success(), delegatebatch( alice, { { bob, net, cpu }, { carol, net, cpu }, { bob, net, cpu } } ) );
+    BOOST_REQUIRE_EQUAL( init_balance - core_sym::from_string("30.0000"), get_balance( alice ) );
+    BOOST_REQUIRE_EQUAL( staked + 300000, get_voter_info( alice )["staked"].as_int64() );
+    auto dbw = get_dbw_obj( alice, bob );
+    BOOST_REQUIRE_EQUAL( core_sym::from_string("6.0000"), dbw["net_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( core_sym::from_string("14.0000"), dbw["cpu_weight"].as<asset>() );
+    dbw = get_dbw_obj( alice, carol );
+    BOOST_REQUIRE_EQUAL( net, dbw["net_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( cpu, dbw["cpu_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( bob_net + core_sym::from_string("6.0000"), get_total_stake( bob )["net_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( bob_cpu + core_sym::from_string("14.0000"), get_total_stake( bob )["cpu_weight"].as<asset>() );
+
+    // with transfer the stake and its voting power belong to the receiver
+    const int64_t dana_staked = get_voter_info( dana )["staked"].as_int64();
+    BOOST_REQUIRE_EQUAL( success(), delegatebatch( alice, { { dana, net, cpu } }, true ) );
+    BOOST_REQUIRE_EQUAL( init_balance - core_sym::from_string("40.0000"), get_balance( alice ) );
+    BOOST_REQUIRE( get_dbw_obj( alice, dana ).is_null() );
+    BOOST_REQUIRE_EQUAL( net + core_sym::from_string("10.0000"), get_dbw_obj( dana, dana )["net_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( dana_staked + (net + cpu).get_amount(), get_voter_info( dana )["staked"].as_int64() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( refundexec_empty_queue, eosio_system_tester ) try {
+    BOOST_REQUIRE_EQUAL( wasm_assert_msg("max must be positive"), refundexec( "alice1111111"_n, 0 ) );
+    BOOST_REQUIRE_EQUAL( success(), refundexec( "alice1111111"_n, 10 ) );
+    BOOST_REQUIRE( get_refund_request( "alice1111111"_n ).is_null() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( refundexec_pays_due_refunds, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n, "danaaccount1"_n };
+    const account_name alice = accounts[0], bob = accounts[1], carol = accounts[2], dana = accounts[3];
+    setup_rex_accounts( accounts, init_balance, core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+    activate_network();
+    produce_block();
+
+    // each account self-stakes 10.0000 NET and CPU
+    const asset    amount           = core_sym::from_string("2.0000");
+    const uint32_t refund_delay_sec = 3 * 24 * 3600;
+    auto ready_time = [&]( const account_name& owner ) {
+       return get_refund_request( owner )["request_time"].as<time_point_sec>().sec_since_epoch() + refund_delay_sec;
+    };
+    auto queued_time = [&]( const account_name& owner ) {
+       return get_refund_queue_entry( owner )["ready_time"].as<time_point_sec>().sec_since_epoch();
+    };
+
+    // every unstake queues its owner, the entry is billed to the system account
+    for( const auto& a : accounts ) {
+       BOOST_REQUIRE_EQUAL( success(), unstake( a, a, amount, amount ) );
+       BOOST_REQUIRE_EQUAL( ready_time( a ), queued_time( a ) );
+    }
+    BOOST_REQUIRE_EQUAL( init_balance, get_balance( alice ) );
+
+    // nothing is due before refund_delay_sec
+    produce_block( fc::days(2) );
+    BOOST_REQUIRE_EQUAL( success(), refundexec( dana, 10 ) );
+    for( const auto& a : accounts ) {
+       BOOST_REQUIRE( !get_refund_request( a ).is_null() );
+       BOOST_REQUIRE( !get_refund_queue_entry( a ).is_null() );
+    }
+
+    // a second unstake restarts bob's timer and moves his queue entry with it
+    const uint32_t first_ready = queued_time( bob );
+    BOOST_REQUIRE_EQUAL( success(), unstake( bob, bob, amount, amount ) );
+    BOOST_REQUIRE( ready_time( bob ) > first_ready );
+    BOOST_REQUIRE_EQUAL( ready_time( bob ), queued_time( bob ) );
+
+    // restaking the whole refund cancels carol's request without a transfer and removes her entry
+    BOOST_REQUIRE_EQUAL( success(), stake( carol, carol, amount, amount ) );
+    BOOST_REQUIRE( get_refund_request( carol ).is_null() );
+    BOOST_REQUIRE( get_refund_queue_entry( carol ).is_null() );
+
+    produce_block( fc::days(1) );
+    produce_blocks( 2 );
+
+    // a manual refund removes the queue entry
+    BOOST_REQUIRE_EQUAL( success(), refund( dana ) );
+    BOOST_REQUIRE_EQUAL( init_balance + amount + amount, get_balance( dana ) );
+    BOOST_REQUIRE( get_refund_request( dana ).is_null() );
+    BOOST_REQUIRE( get_refund_queue_entry( dana ).is_null() );
+
+    // alice is paid, bob's restarted refund is not due yet
+    BOOST_REQUIRE_EQUAL( success(), refundexec( dana, 10 ) );
+    BOOST_REQUIRE_EQUAL( init_balance + amount + amount, get_balance( alice ) );
+    BOOST_REQUIRE( get_refund_request( alice ).is_null() );
+    BOOST_REQUIRE( get_refund_queue_entry( alice ).is_null() );
+    BOOST_REQUIRE_EQUAL( init_balance, get_balance( bob ) );
+    BOOST_REQUIRE_EQUAL( ready_time( bob ), queued_time( bob ) );
+    BOOST_REQUIRE_EQUAL( init_balance, get_balance( carol ) );
+    BOOST_REQUIRE( get_refund_queue_entry( carol ).is_null() );
+
+    produce_block( fc::days(2) );
+    produce_blocks( 2 );
+    BOOST_REQUIRE_EQUAL( success(), refundexec( dana, 10 ) );
+    BOOST_REQUIRE_EQUAL( init_balance + core_sym::from_string("8.0000"), get_balance( bob ) );
+    BOOST_REQUIRE( get_refund_request( bob ).is_null() );
+    BOOST_REQUIRE( get_refund_queue_entry( bob ).is_null() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( refundexec_skips_owners, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n, "carolaccount"_n };
+    const account_name alice = accounts[0], bob = accounts[1], carol = accounts[2];
+    setup_rex_accounts( accounts, init_balance, core_sym::from_string("80.0000"), core_sym::from_string("80.0000"), false );
+    activate_network();
+    produce_block();
+
+    const asset amount = core_sym::from_string("2.0000");
+    BOOST_REQUIRE_EQUAL( success(), unstake( alice, alice, amount, amount ) );
+    produce_blocks( 2 );
+    BOOST_REQUIRE_EQUAL( success(), unstake( bob, bob, amount, amount ) );
+    produce_block( fc::days(3) );
+    produce_blocks( 2 );
+
+    // alice is first in line; stepping over her pays bob and keeps her entry
+    BOOST_REQUIRE_EQUAL( success(), refundexec( carol, 10, { alice } ) );
+    BOOST_REQUIRE_EQUAL( init_balance, get_balance( alice ) );
+    BOOST_REQUIRE( !get_refund_queue_entry( alice ).is_null() );
+    BOOST_REQUIRE_EQUAL( init_balance + amount + amount, get_balance( bob ) );
+    BOOST_REQUIRE( get_refund_queue_entry( bob ).is_null() );
+
+    // she can still claim herself
+    BOOST_REQUIRE_EQUAL( success(), refund( alice ) );
+    BOOST_REQUIRE_EQUAL( init_balance + amount + amount, get_balance( alice ) );
+    BOOST_REQUIRE( get_refund_queue_entry( alice ).is_null() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( runrex_merges_cpu_and_net_loans, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const std::vector<account_name> accounts = { "aliceaccount"_n, "bobbyaccount"_n };
+    const account_name alice = accounts[0], bob = accounts[1];
+    setup_rex_accounts( accounts, init_balance );
+
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("500.0000") ) );
+    const auto initial = get_total_stake( bob );
+
+    // interleaved loans, loan numbers are shared: cpu loans are odd, net loans even
+    const uint64_t pairs = 6;
+    for( uint64_t i = 0; i < pairs; ++i ) {
+        BOOST_REQUIRE_EQUAL( success(), rentcpu( bob, bob, core_sym::from_string("1.0000") ) );
+        BOOST_REQUIRE_EQUAL( success(), rentnet( bob, bob, core_sym::from_string("1.0000") ) );
+    }
+
+    auto require_processed_through = [&]( uint64_t last ) {
+        for( uint64_t n = 1; n <= 2 * pairs; ++n ) {
+            BOOST_REQUIRE_EQUAL( n <= last, ( n % 2 ? get_cpu_loan( n ) : get_net_loan( n ) ).is_null() );
+        }
+    };
+
+    // an explicit rexexec max is honored, loans go oldest first across both tables
+    produce_block( fc::days(31) );
+    produce_blocks( 2 );
+    BOOST_REQUIRE_EQUAL( success(), rexexec( alice, 1 ) );
+    require_processed_through( 1 );
+
+    // a user REX action runs 2 loans, then half of the 9 still due (rounded up)
+    BOOST_REQUIRE_EQUAL( success(), updaterex( alice ) );
+    require_processed_through( 8 );
+
+    BOOST_REQUIRE_EQUAL( success(), rexexec( alice, 4 ) );
+    BOOST_REQUIRE_EQUAL( 0, get_rex_pool()["total_lent"].as<asset>().get_amount() );
+    const auto final_stake = get_total_stake( bob );
+    BOOST_REQUIRE_EQUAL( initial["net_weight"].as<asset>(), final_stake["net_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( initial["cpu_weight"].as<asset>(), final_stake["cpu_weight"].as<asset>() );
+
+    // loans from different payers to the same receiver are returned in one pass
+    BOOST_REQUIRE_EQUAL( success(), rentcpu( alice, bob, core_sym::from_string("1.0000") ) );
+    BOOST_REQUIRE_EQUAL( success(), rentcpu( bob, bob, core_sym::from_string("1.0000") ) );
+    BOOST_REQUIRE_EQUAL( success(), rentnet( alice, bob, core_sym::from_string("1.0000") ) );
+    BOOST_REQUIRE( get_total_stake( bob )["cpu_weight"].as<asset>() > initial["cpu_weight"].as<asset>() );
+    produce_block( fc::days(31) );
+    produce_blocks( 2 );
+    BOOST_REQUIRE_EQUAL( success(), rexexec( alice, 3 ) );
+    BOOST_REQUIRE_EQUAL( 0, get_rex_pool()["total_lent"].as<asset>().get_amount() );
+    const auto mixed_stake = get_total_stake( bob );
+    BOOST_REQUIRE_EQUAL( initial["net_weight"].as<asset>(), mixed_stake["net_weight"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( initial["cpu_weight"].as<asset>(), mixed_stake["cpu_weight"].as<asset>() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_FIXTURE_TEST_CASE( rex_read_only_queries, eosio_system_tester ) try {
+    const asset init_balance = core_sym::from_string("1000.0000");
+    const account_name alice = "aliceaccount"_n;
+    setup_rex_accounts( { alice }, init_balance );
+
+    BOOST_REQUIRE_EQUAL( success(), buyrex( alice, core_sym::from_string("100.0000") ) );
+    const asset rex = get_rex_balance( alice );
+    const asset to_savings = asset( rex.get_amount() / 4, symbol(SY(4, REX)) );
+    BOOST_REQUIRE_EQUAL( success(), mvtosavings( alice, to_savings ) );
+
+    // the price matches the pool row
+    auto pool  = get_rex_pool();
+    auto price = getrexprice();
+    BOOST_REQUIRE_EQUAL( pool["total_lendable"].as<asset>(), price["total_lendable"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( pool["total_rex"].as<asset>(), price["total_rex"].as<asset>() );
+    const int64_t rex_value = ( __uint128_t(10000) * pool["total_lendable"].as<asset>().get_amount() ) / pool["total_rex"].as<asset>().get_amount();
+    BOOST_REQUIRE_EQUAL( rex_value, price["rex_value"].as<asset>().get_amount() );
+
+    // nothing matured yet, the stored row is not touched
+    const auto stored = get_rex_balance_obj( alice );
+    auto pos = getrexpos( alice );
+    BOOST_REQUIRE_EQUAL( rex, pos["rex_balance"].as<asset>() );
+    BOOST_REQUIRE_EQUAL( int64_t( ( __uint128_t(rex.get_amount()) * pool["total_lendable"].as<asset>().get_amount() ) /
+                                  pool["total_rex"].as<asset>().get_amount() ),
+                         pos["value"].as<asset>().get_amount() );
+    BOOST_REQUIRE_EQUAL( 0, pos["matured_rex"].as_int64() );
+    BOOST_REQUIRE_EQUAL( to_savings.get_amount(), pos["savings_rex"].as_int64() );
+    BOOST_REQUIRE_EQUAL( rex.get_amount() - to_savings.get_amount(), pos["unmatured_rex"].as_int64() );
+    BOOST_REQUIRE_EQUAL( 1, pos["maturities"].get_array().size() );
+    BOOST_REQUIRE_EQUAL( false, pos["has_order"].as<bool>() );
+    BOOST_REQUIRE_EQUAL( stored["matured_rex"].as_int64(), get_rex_balance_obj( alice )["matured_rex"].as_int64() );
+
+    // maturities are applied on the fly
+    produce_block( fc::days(5) );
+    produce_blocks( 2 );
+    pos = getrexpos( alice );
+    BOOST_REQUIRE_EQUAL( rex.get_amount() - to_savings.get_amount(), pos["matured_rex"].as_int64() );
+    BOOST_REQUIRE_EQUAL( 0, pos["unmatured_rex"].as_int64() );
+    BOOST_REQUIRE_EQUAL( 0, pos["maturities"].get_array().size() );
+    BOOST_REQUIRE_EQUAL( 0, get_rex_balance_obj( alice )["matured_rex"].as_int64() );
+
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_SUITE_END()